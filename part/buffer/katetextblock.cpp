@@ -21,11 +21,13 @@
 #include "katetextblock.h"
 #include "katetextbuffer.h"
 
+#include <QtCore/QtAlgorithms>
+
 namespace Kate {
 
-TextBlock::TextBlock (TextBuffer *buffer, int startLine)
+TextBlock::TextBlock (TextBuffer *buffer, int blockIndex)
   : m_buffer (buffer)
-  , m_startLine (startLine)
+  , m_blockIndex (blockIndex)
 {
   // reserve the block size
   m_lines.reserve (m_buffer->m_blockSize);
@@ -35,18 +37,14 @@ TextBlock::~TextBlock ()
 {
   // blocks should be empty before they are deleted!
   Q_ASSERT (m_lines.empty());
-  Q_ASSERT (m_cursors.empty());
+  Q_ASSERT (!hasCursors());
 
   // it only is a hint for ranges for this block, not the storage of them
 }
 
-void TextBlock::setStartLine (int startLine)
+int TextBlock::startLine () const
 {
-  // allow only valid lines
-  Q_ASSERT (startLine >= 0);
-  Q_ASSERT (startLine < m_buffer->lines ());
-
-  m_startLine = startLine;
+  return m_buffer->startLineOfBlock (m_blockIndex);
 }
 
 TextLine TextBlock::line (int line) const
@@ -66,7 +64,13 @@ TextLine TextBlock::line (int line) const
 
 void TextBlock::appendLine (const QString &textOfLine)
 {
-  m_lines.append (TextLine (new TextLineData(textOfLine)));
+  TextLine textLine (new TextLineData(textOfLine));
+
+  // store text as 8-bit data, if wanted and possible
+  if (m_buffer->compactLineStorage ())
+    textLine->compact ();
+
+  m_lines.append (textLine);
 }
 
 void TextBlock::clearLines ()
@@ -82,7 +86,7 @@ void TextBlock::text (QString &text) const
       if (i > 0 || startLine() > 0)
         text.append ('\n');
 
-      text.append (m_lines.at(i)->text ());
+      text.append (m_lines.at(i)->textCopy ());
   }
 }
 
@@ -141,45 +145,42 @@ void TextBlock::wrapLine (const KTextEditor::Cursor &position, int fixStartLines
 
   // no cursors will leave or join this block
 
-  // no cursors in this block, no work to do..
-  if (m_cursors.empty())
+  // no cursors on the wrapped line or behind it, no work to do..
+  if (m_cursorsForLine.size() <= line)
     return;
 
-  // move all cursors on the line which has the text inserted
+  // move all cursors on lines behind the wrapped one
   // remember all ranges modified
   QSet<TextRange *> changedRanges;
-  foreach (TextCursor *cursor, m_cursors) {
-      // skip cursors on lines in front of the wrapped one!
-      if (cursor->lineInBlock() < line)
-        continue;
-
-      // either this is simple, line behind the wrapped one
-      if (cursor->lineInBlock() > line) {
-        // patch line of cursor
-        cursor->m_line++;
-      }
-
-      // this is the wrapped line
-      else {
-        // skip cursors with too small column
-        if (cursor->column() <= position.column()) {
-          if (cursor->column() < position.column() || !cursor->m_moveOnInsert)
-            continue;
-        }
-
-        // move cursor
-
-        // patch line of cursor
-        cursor->m_line++;
-
-        // patch column
-        cursor->m_column -= position.column();
-      }
+  for (int i = line + 1; i < m_cursorsForLine.size(); ++i) {
+    foreach (TextCursor *cursor, m_cursorsForLine.at(i)) {
+      // patch line of cursor
+      cursor->m_line++;
 
       // remember range, if any
       if (cursor->kateRange())
         changedRanges.insert (cursor->kateRange());
+    }
+  }
+
+  // move the cursors of the wrapped line behind the wrap position to the new line
+  QVector<TextCursor *> &cursors = m_cursorsForLine[line];
+  QVector<TextCursor *> movedCursors;
+  const int firstToMove = firstCursorToMove (cursors, position.column());
+  for (int i = firstToMove; i < cursors.size(); ++i) {
+    TextCursor *cursor = cursors.at(i);
+
+    // patch line + column of cursor
+    cursor->m_line++;
+    cursor->m_column -= position.column();
+    movedCursors.append (cursor);
+
+    // remember range, if any
+    if (cursor->kateRange())
+      changedRanges.insert (cursor->kateRange());
   }
+  cursors.resize (firstToMove);
+  m_cursorsForLine.insert (line + 1, movedCursors);
 
   // check validity of all ranges, might invalidate them...
   foreach (TextRange *range, changedRanges)
@@ -213,11 +214,8 @@ void TextBlock::unwrapLine (int line, TextBlock *previousBlock, int fixStartLine
       newFirst->markAsModified(true);
     }
 
-    // patch startLine of this block
-    --m_startLine;
-
     /**
-     * fix all start lines
+     * fix all start lines, this will patch the startLine of this block, too
      * we need to do this NOW, else the range update will FAIL!
      * bug 313759
      */
@@ -232,41 +230,52 @@ void TextBlock::unwrapLine (int line, TextBlock *previousBlock, int fixStartLine
      * cursor and range handling below
      */
 
-    // no cursors in this block and the previous one, no work to do..
-    if (m_cursors.empty() && previousBlock->m_cursors.empty())
+    // no cursors on the unwrapped line in this block and the previous one, no work to do..
+    const bool cursorsInThisLine = !m_cursorsForLine.isEmpty() && !m_cursorsForLine.first().isEmpty();
+    const bool cursorsInPreviousLine = (lastLineOfPreviousBlock < previousBlock->m_cursorsForLine.size())
+                                         && !previousBlock->m_cursorsForLine.at(lastLineOfPreviousBlock).isEmpty();
+    if (!cursorsInThisLine && !cursorsInPreviousLine)
       return;
 
     // move all cursors because of the unwrapped line
     // remember all ranges modified
     QSet<TextRange *> changedRanges;
-    foreach (TextCursor *cursor, m_cursors) {
-        // this is the unwrapped line
-        if (cursor->lineInBlock() == 0) {
-          // patch column
-          cursor->m_column += oldSizeOfPreviousLine;
-
-          // remember range, if any
-          if (cursor->kateRange())
-            changedRanges.insert (cursor->kateRange());
-        }
+    QVector<TextCursor *> unwrappedCursors;
+    if (cursorsInThisLine) {
+      unwrappedCursors = m_cursorsForLine.first();
+      foreach (TextCursor *cursor, unwrappedCursors) {
+        // patch column
+        cursor->m_column += oldSizeOfPreviousLine;
+
+        // remember range, if any
+        if (cursor->kateRange())
+          changedRanges.insert (cursor->kateRange());
+      }
     }
 
     // move cursors of the moved line from previous block to this block now
-    QSet<TextCursor *> newPreviousCursors;
-    foreach (TextCursor *cursor, previousBlock->m_cursors) {
-      if (cursor->lineInBlock() == lastLineOfPreviousBlock) {
+    QVector<TextCursor *> movedCursors;
+    if (cursorsInPreviousLine) {
+      movedCursors = previousBlock->m_cursorsForLine.at(lastLineOfPreviousBlock);
+      foreach (TextCursor *cursor, movedCursors) {
         cursor->m_line = 0;
         cursor->m_block = this;
-        m_cursors.insert (cursor);
 
         // remember range, if any
         if (cursor->kateRange())
           changedRanges.insert (cursor->kateRange());
       }
-      else
-        newPreviousCursors.insert (cursor);
     }
-    previousBlock->m_cursors = newPreviousCursors;
+
+    // the last line of the previous block is gone, it has no cursors anymore
+    if (lastLineOfPreviousBlock < previousBlock->m_cursorsForLine.size())
+      previousBlock->m_cursorsForLine.resize (lastLineOfPreviousBlock);
+
+    // the moved cursors come first, they were in front of the unwrapped ones
+    appendCursors (movedCursors, unwrappedCursors);
+    if (m_cursorsForLine.isEmpty())
+      m_cursorsForLine.resize (1);
+    m_cursorsForLine[0] = movedCursors;
 
     // fixup the ranges that might be effected, because they moved from last line to this block
     foreach (TextRange *range, changedRanges) {
@@ -313,20 +322,17 @@ void TextBlock::unwrapLine (int line, TextBlock *previousBlock, int fixStartLine
    * cursor and range handling below
    */
 
-  // no cursors in this block, no work to do..
-  if (m_cursors.empty())
+  // no cursors on the unwrapped line or behind it, no work to do..
+  if (m_cursorsForLine.size() <= line)
     return;
 
   // move all cursors because of the unwrapped line
   // remember all ranges modified
   QSet<TextRange *> changedRanges;
-  foreach (TextCursor *cursor, m_cursors) {
-      // skip cursors in lines in front of removed one
-      if (cursor->lineInBlock() < line)
-        continue;
-
+  for (int i = line; i < m_cursorsForLine.size(); ++i) {
+    foreach (TextCursor *cursor, m_cursorsForLine.at(i)) {
       // this is the unwrapped line
-      if (cursor->lineInBlock() == line) {
+      if (i == line) {
         // patch column
         cursor->m_column += oldSizeOfPreviousLine;
       }
@@ -337,8 +343,14 @@ void TextBlock::unwrapLine (int line, TextBlock *previousBlock, int fixStartLine
       // remember range, if any
       if (cursor->kateRange())
         changedRanges.insert (cursor->kateRange());
+    }
   }
 
+  // cursors of the unwrapped line join the previous one
+  const QVector<TextCursor *> unwrappedCursors = m_cursorsForLine.at(line);
+  m_cursorsForLine.remove (line);
+  appendCursors (m_cursorsForLine[line-1], unwrappedCursors);
+
   // check validity of all ranges, might invalidate them...
   foreach (TextRange *range, changedRanges)
     range->checkValidity ();
@@ -370,23 +382,16 @@ void TextBlock::insertText (const KTextEditor::Cursor &position, const QString &
    * cursor and range handling below
    */
 
-  // no cursors in this block, no work to do..
-  if (m_cursors.empty())
+  // no cursors on this line, no work to do..
+  if (line >= m_cursorsForLine.size() || m_cursorsForLine.at(line).isEmpty())
     return;
 
-  // move all cursors on the line which has the text inserted
+  // move all cursors on the line which has the text inserted, only the ones behind the insert position
   // remember all ranges modified
   QSet<TextRange *> changedRanges;
-  foreach (TextCursor *cursor, m_cursors) {
-      // skip cursors not on this line!
-      if (cursor->lineInBlock() != line)
-        continue;
-
-      // skip cursors with too small column
-      if (cursor->column() <= position.column()) {
-        if (cursor->column() < position.column() || !cursor->m_moveOnInsert)
-          continue;
-      }
+  QVector<TextCursor *> &cursors = m_cursorsForLine[line];
+  for (int i = firstCursorToMove (cursors, position.column()); i < cursors.size(); ++i) {
+      TextCursor *cursor = cursors.at(i);
 
       // patch column of cursor
       if (cursor->m_column <= oldLength)
@@ -437,21 +442,16 @@ void TextBlock::removeText (const KTextEditor::Range &range, QString &removedTex
    * cursor and range handling below
    */
 
-  // no cursors in this block, no work to do..
-  if (m_cursors.empty())
+  // no cursors on this line, no work to do..
+  if (line >= m_cursorsForLine.size() || m_cursorsForLine.at(line).isEmpty())
     return;
 
-  // move all cursors on the line which has the text removed
+  // move all cursors on the line which has the text removed, only the ones behind the start of the removed text
   // remember all ranges modified
   QSet<TextRange *> changedRanges;
-  foreach (TextCursor *cursor, m_cursors) {
-      // skip cursors not on this line!
-      if (cursor->lineInBlock() != line)
-        continue;
-
-      // skip cursors with too small column
-      if (cursor->column() <= range.start().column())
-          continue;
+  const QVector<TextCursor *> &cursors = m_cursorsForLine.at(line);
+  for (int i = lowerBoundCursor (cursors, range.start().column() + 1); i < cursors.size(); ++i) {
+      TextCursor *cursor = cursors.at(i);
 
       // patch column of cursor
       if (cursor->column() <= range.end().column())
@@ -482,8 +482,8 @@ TextBlock *TextBlock::splitBlock (int fromLine)
   // half the block
   int linesOfNewBlock = lines () - fromLine;
 
-  // create and insert new block
-  TextBlock *newBlock = new TextBlock (m_buffer, startLine() + fromLine);
+  // create new block, the buffer will insert it behind this one
+  TextBlock *newBlock = new TextBlock (m_buffer, m_blockIndex + 1);
 
   // move lines
   newBlock->m_lines.reserve (linesOfNewBlock);
@@ -492,18 +492,23 @@ TextBlock *TextBlock::splitBlock (int fromLine)
   m_lines.resize (fromLine);
 
   // move cursors
-  QSet<TextCursor*> oldBlockSet;
-  foreach (TextCursor *cursor, m_cursors) {
-      if (cursor->lineInBlock() >= fromLine) {
-        cursor->m_line = cursor->lineInBlock() - fromLine;
+  if (fromLine < m_cursorsForLine.size()) {
+    newBlock->m_cursorsForLine = m_cursorsForLine.mid (fromLine);
+    m_cursorsForLine.resize (fromLine);
+    for (int i = 0; i < newBlock->m_cursorsForLine.size(); ++i) {
+      foreach (TextCursor *cursor, newBlock->m_cursorsForLine.at(i)) {
+        cursor->m_line = i;
         cursor->m_block = newBlock;
-        newBlock->m_cursors.insert (cursor);
       }
-      else
-        oldBlockSet.insert (cursor);
+    }
   }
-  m_cursors = oldBlockSet;
 
+  // return the new generated block
+  return newBlock;
+}
+
+void TextBlock::fixRangesAfterSplit (TextBlock *newBlock)
+{
   // fix ALL ranges!
   QList<TextRange*> allRanges = m_uncachedRanges.toList() + m_cachedLineForRanges.keys();
   foreach (TextRange *range, allRanges) {
@@ -511,20 +516,22 @@ TextBlock *TextBlock::splitBlock (int fromLine)
       updateRange (range);
       newBlock->updateRange (range);
   }
-
-  // return the new generated block
-  return newBlock;
 }
 
 void TextBlock::mergeBlock (TextBlock *targetBlock)
 {
   // move cursors, do this first, now still lines() count is correct for target
-  foreach (TextCursor *cursor, m_cursors) {
-    cursor->m_line = cursor->lineInBlock() + targetBlock->lines ();
-    cursor->m_block = targetBlock;
-    targetBlock->m_cursors.insert (cursor);
+  if (hasCursors()) {
+    targetBlock->m_cursorsForLine.resize (targetBlock->lines ());
+    for (int i = 0; i < m_cursorsForLine.size(); ++i) {
+      foreach (TextCursor *cursor, m_cursorsForLine.at(i)) {
+        cursor->m_line = i + targetBlock->lines ();
+        cursor->m_block = targetBlock;
+      }
+      targetBlock->m_cursorsForLine.append (m_cursorsForLine.at(i));
+    }
   }
-  m_cursors.clear ();
+  m_cursorsForLine.clear ();
 
   // move lines
   targetBlock->m_lines.reserve (targetBlock->lines() + lines ());
@@ -543,11 +550,12 @@ void TextBlock::mergeBlock (TextBlock *targetBlock)
 
 void TextBlock::deleteBlockContent ()
 {
-  // kill cursors, if not belonging to a range
-  QSet<TextCursor *> copy = m_cursors;
-  foreach (TextCursor *cursor, copy)
-    if (!cursor->kateRange())
-      delete cursor;
+  // kill cursors, if not belonging to a range, work on copy, they will remove themself
+  const QVector<QVector<TextCursor *> > copy = m_cursorsForLine;
+  foreach (const QVector<TextCursor *> &cursors, copy)
+    foreach (TextCursor *cursor, cursors)
+      if (!cursor->kateRange())
+        delete cursor;
 
   // kill lines
   m_lines.clear ();
@@ -555,15 +563,17 @@ void TextBlock::deleteBlockContent ()
 
 void TextBlock::clearBlockContent (TextBlock *targetBlock)
 {
-  // move cursors, if not belonging to a range
-  QSet<TextCursor *> copy = m_cursors;
-  foreach (TextCursor *cursor, copy) {
-    if (!cursor->kateRange()) {
-      cursor->m_column = 0;
-      cursor->m_line = 0;
-      cursor->m_block = targetBlock;
-      targetBlock->m_cursors.insert (cursor);
-      m_cursors.remove (cursor);
+  // move cursors, if not belonging to a range, work on copy
+  const QVector<QVector<TextCursor *> > copy = m_cursorsForLine;
+  foreach (const QVector<TextCursor *> &cursors, copy) {
+    foreach (TextCursor *cursor, cursors) {
+      if (!cursor->kateRange()) {
+        removeCursor (cursor);
+        cursor->m_column = 0;
+        cursor->m_line = 0;
+        cursor->m_block = targetBlock;
+        targetBlock->insertCursor (cursor);
+      }
     }
   }
 
@@ -571,6 +581,94 @@ void TextBlock::clearBlockContent (TextBlock *targetBlock)
   m_lines.clear ();
 }
 
+void TextBlock::insertCursor (Kate::TextCursor *cursor)
+{
+  // enlarge cursor lists if needed
+  const int line = cursor->lineInBlock ();
+  Q_ASSERT (line >= 0);
+  if (m_cursorsForLine.size() <= line)
+    m_cursorsForLine.resize (line + 1);
+
+  // insert behind all cursors with smaller or same column
+  QVector<TextCursor *> &cursors = m_cursorsForLine[line];
+  cursors.insert (lowerBoundCursor (cursors, cursor->column() + 1), cursor);
+}
+
+void TextBlock::removeCursor (Kate::TextCursor *cursor)
+{
+  // cursor must be in the list of its line, search it in the cursors with same column
+  const int line = cursor->lineInBlock ();
+  Q_ASSERT (line >= 0 && line < m_cursorsForLine.size());
+  QVector<TextCursor *> &cursors = m_cursorsForLine[line];
+  for (int i = lowerBoundCursor (cursors, cursor->column()); i < cursors.size(); ++i) {
+    if (cursors.at(i) == cursor) {
+      cursors.remove (i);
+      return;
+    }
+  }
+
+  // not found, that should not happen
+  Q_ASSERT (false);
+}
+
+bool TextBlock::hasCursors () const
+{
+  for (int i = 0; i < m_cursorsForLine.size(); ++i)
+    if (!m_cursorsForLine.at(i).isEmpty())
+      return true;
+
+  return false;
+}
+
+int TextBlock::lowerBoundCursor (const QVector<TextCursor *> &cursors, int column)
+{
+  // binary search, cursors are sorted by column
+  int first = 0;
+  int last = cursors.size();
+  while (first < last) {
+    const int middle = first + (last - first) / 2;
+    if (cursors.at(middle)->column() < column)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  return first;
+}
+
+int TextBlock::firstCursorToMove (QVector<TextCursor *> &cursors, int column)
+{
+  // skip cursors with too small column
+  int firstToMove = lowerBoundCursor (cursors, column);
+
+  // cursors exactly at the column only move if they want to, put the other ones first
+  for (int i = firstToMove; i < cursors.size() && cursors.at(i)->column() == column; ++i) {
+    if (!cursors.at(i)->m_moveOnInsert) {
+      qSwap (cursors[i], cursors[firstToMove]);
+      ++firstToMove;
+    }
+  }
+
+  return firstToMove;
+}
+
+static bool cursorColumnLessThan (const TextCursor *a, const TextCursor *b)
+{
+  return a->column() < b->column();
+}
+
+void TextBlock::appendCursors (QVector<TextCursor *> &cursors, const QVector<TextCursor *> &appendedCursors)
+{
+  if (appendedCursors.isEmpty())
+    return;
+
+  // cursors might be behind the end of their line, only then the order is not given
+  const bool needsSort = !cursors.isEmpty() && (cursors.last()->column() > appendedCursors.first()->column());
+  cursors += appendedCursors;
+  if (needsSort)
+    qStableSort (cursors.begin(), cursors.end(), cursorColumnLessThan);
+}
+
 void TextBlock::markModifiedLinesAsSaved ()
 {
   // mark all modified lines as saved
@@ -589,25 +687,28 @@ void TextBlock::updateRange (TextRange* range)
   const int startLine = range->startInternal().lineInternal();
   const int endLine = range->endInternal().lineInternal();
   const bool isSingleLine = startLine == endLine;
+  const int blockStartLine = this->startLine ();
 
   /**
    * perhaps remove range and be done
    */
-  if ((endLine < m_startLine) || (startLine >= (m_startLine + lines()))) {
+  if ((endLine < blockStartLine) || (startLine >= (blockStartLine + lines()))) {
     removeRange (range);
     return;
   }
 
   /**
    * The range is still a single-line range, and is still cached to the correct line.
+   * Only one hash lookup, this is called for each range on each split/merge/unwrap.
    */
-  if(isSingleLine && m_cachedLineForRanges.contains (range) && (m_cachedLineForRanges.value(range) == startLine - m_startLine))
+  const QHash<TextRange *, int>::const_iterator cached = m_cachedLineForRanges.constFind (range);
+  if (isSingleLine && (cached != m_cachedLineForRanges.constEnd()) && (cached.value() == startLine - blockStartLine))
     return;
 
   /**
    * The range is still a multi-line range, and is already in the correct set.
    */
-  if(!isSingleLine && m_uncachedRanges.contains (range))
+  if (!isSingleLine && (cached == m_cachedLineForRanges.constEnd()) && m_uncachedRanges.contains (range))
     return;
 
   /**
@@ -629,7 +730,7 @@ void TextBlock::updateRange (TextRange* range)
   /**
    * The range is contained by a single line, put it into the line-cache
    */
-  const int lineOffset = startLine - m_startLine;
+  const int lineOffset = startLine - blockStartLine;
 
   /**
    * enlarge cache if needed
@@ -44,9 +44,9 @@ class KATEPART_TESTS_EXPORT TextBlock {
     /**
      * Construct an empty text block.
      * @param buffer parent text buffer
-     * @param startLine start line of this block
+     * @param blockIndex index of this block in the block list of the buffer
      */
-    TextBlock (TextBuffer *buffer, int startLine);
+    TextBlock (TextBuffer *buffer, int blockIndex);
 
     /**
      * Destruct the text block
@@ -55,15 +55,22 @@ class KATEPART_TESTS_EXPORT TextBlock {
 
     /**
      * Start line of this block.
+     * Looked up in the line index of the buffer, O(log blocks).
      * @return start line of this block
      */
-    int startLine () const { return m_startLine; }
+    int startLine () const;
 
     /**
-     * Set start line of this block.
-     * @param startLine new start line of this block
+     * Index of this block in the block list of the buffer.
+     * @return block index
      */
-    void setStartLine (int startLine);
+    int blockIndex () const { return m_blockIndex; }
+
+    /**
+     * Set index of this block in the block list of the buffer.
+     * @param blockIndex new block index
+     */
+    void setBlockIndex (int blockIndex) { m_blockIndex = blockIndex; }
 
     /**
      * Retrieve a text line.
@@ -133,11 +140,18 @@ class KATEPART_TESTS_EXPORT TextBlock {
     /**
      * Split given block. A new block will be created and all lines starting from the given index will
      * be moved to it, together with the cursors belonging to it.
+     * The ranges are not touched, call fixRangesAfterSplit once the new block is part of the buffer.
      * @param fromLine line from which to split
      * @return new block containing the lines + cursors removed from this one
      */
     TextBlock *splitBlock (int fromLine);
 
+    /**
+     * Update all ranges of this block after it got split.
+     * @param newBlock block created by splitBlock, must already be part of the buffer
+     */
+    void fixRangesAfterSplit (TextBlock *newBlock);
+
     /**
      * Merge this block with given one, the given one must be a direct predecessor.
      * @param targetBlock block to merge with
@@ -159,13 +173,11 @@ class KATEPART_TESTS_EXPORT TextBlock {
     void clearBlockContent (TextBlock *targetBlock);
 
     /**
-     * Return all ranges in this block which might intersect the given line.
-     * @param line line to check intersection
-     * @return list of sets of possible candidate ranges
+     * Return all ranges in this block which span multiple lines.
+     * These might intersect any line of this block.
+     * @return set of multi-line ranges
      */
-    QList<QSet<TextRange*> > rangesForLine (int line) const {
-      return QList<QSet<TextRange*> >() << m_uncachedRanges << cachedRangesForLine(line);
-    }
+    const QSet<TextRange*> &uncachedRanges () const { return m_uncachedRanges; }
 
     /**
      * Is the given range contained in this block?
@@ -183,15 +195,17 @@ class KATEPART_TESTS_EXPORT TextBlock {
     
     /**
      * Insert cursor into this block.
+     * The cursor must already have its line and column in this block set.
      * @param cursor cursor to insert
      */
-    void insertCursor (Kate::TextCursor *cursor) { m_cursors.insert (cursor); }
+    void insertCursor (Kate::TextCursor *cursor);
     
     /**
      * Remove cursor from this block.
+     * Must be called before the line or column of the cursor are changed.
      * @param cursor cursor to remove
      */
-    void removeCursor (Kate::TextCursor *cursor) { m_cursors.remove (cursor); }
+    void removeCursor (Kate::TextCursor *cursor);
 
     /**
      * Update a range from this block.
@@ -209,17 +223,49 @@ class KATEPART_TESTS_EXPORT TextBlock {
     /**
      * Return all ranges in this block which might intersect the given line and only span one line.
      * For them an internal fast lookup cache is hold.
+     * The set is not copied, the pointer is only valid until the ranges of this block change.
      * @param line line to check intersection
-     * @return set of ranges
+     * @return set of ranges, 0 if there are none
      */
-    QSet<TextRange*> cachedRangesForLine (int line) const {
-      line -= m_startLine;
-      if(line >= 0 && line < m_cachedRangesForLine.size())
-        return m_cachedRangesForLine[line];
+    const QSet<TextRange*> *cachedRangesForLine (int line) const {
+      line -= startLine ();
+      if (line >= 0 && line < m_cachedRangesForLine.size() && !m_cachedRangesForLine[line].isEmpty())
+        return &m_cachedRangesForLine[line];
       else
-        return QSet<TextRange*>();
+        return 0;
     }
 
+  private:
+    /**
+     * Are there any cursors in this block?
+     * @return block has cursors?
+     */
+    bool hasCursors () const;
+
+    /**
+     * Index of the first cursor in the sorted list with a column >= the given one.
+     * @param cursors cursors of one line, sorted by column
+     * @param column column to search for
+     * @return index of first cursor at or behind column
+     */
+    static int lowerBoundCursor (const QVector<TextCursor *> &cursors, int column);
+
+    /**
+     * Index of the first cursor in the sorted list which must move if text is inserted at the given column.
+     * The cursors exactly at that column are reordered, the ones which stay come first, to keep the list sorted after the insertion.
+     * @param cursors cursors of one line, sorted by column
+     * @param column column of insertion
+     * @return index of first cursor to move
+     */
+    static int firstCursorToMove (QVector<TextCursor *> &cursors, int column);
+
+    /**
+     * Append cursors to the cursors of one line and keep them sorted.
+     * @param cursors cursors of one line, sorted by column
+     * @param appendedCursors cursors to append, sorted by column
+     */
+    static void appendCursors (QVector<TextCursor *> &cursors, const QVector<TextCursor *> &appendedCursors);
+
   private:
     /**
      * parent text buffer
@@ -232,14 +278,16 @@ class KATEPART_TESTS_EXPORT TextBlock {
     QVector<Kate::TextLine> m_lines;
 
     /**
-     * Startline of this block
+     * Index of this block in the block list of the buffer
      */
-    int m_startLine;
+    int m_blockIndex;
 
     /**
-     * Set of cursors for this block.
+     * Cursors of this block, for each line-offset sorted by column.
+     * Edits only need to look at the cursors of the changed line behind the edit position.
+     * Might be shorter than m_lines, lines behind the end have no cursors.
      */
-    QSet<TextCursor *> m_cursors;
+    QVector<QVector<TextCursor *> > m_cursorsForLine;
 
     /**
      * Contains for each line-offset the ranges that were cached into it.
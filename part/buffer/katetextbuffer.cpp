@@ -61,6 +61,7 @@ TextBuffer::TextBuffer (KateDocument *parent, int blockSize)
   , m_endOfLineMode (eolUnix)
   , m_newLineAtEof (false)
   , m_lineLengthLimit (4096)
+  , m_compactLineStorage (false)
 {
   // minimal block size must be > 0
   Q_ASSERT (m_blockSize > 0);
@@ -126,6 +127,7 @@ void TextBuffer::clear ()
 
   // insert one block with one empty line
   m_blocks.append (newBlock);
+  rebuildLineIndex (0);
 
   // reset lines and last used block
   m_lines = 1;
@@ -402,38 +404,45 @@ int TextBuffer::blockForLine (int line) const
 
   /**
    * search for right block
-   * use binary search
-   * if we leave this loop not by returning the found element we have an error
+   * descend the line index: find the number of blocks which end in front of the line
+   * empty blocks are skipped, as they don't add to the line count
    */
-  int blockStart = 0;
-  int blockEnd = m_blocks.size() - 1;
-  while (blockEnd >= blockStart) {
-    // get middle and ensure it is OK
-    int middle = blockStart + ((blockEnd - blockStart) / 2);
-    Q_ASSERT (middle >= 0);
-    Q_ASSERT (middle < m_blocks.size());
-
-    // facts bout this block
-    TextBlock* block = m_blocks[middle];
-    const int start = block->startLine();
-    const int lines = block->lines ();
-
-    // right block found, remember it and return it
-    if (start <= line && line < (start + lines)) {
-      m_lastUsedBlock = middle;
-      return middle;
+  const int size = m_lineIndex.size() - 1;
+  int step = 1;
+  while ((step << 1) <= size)
+    step <<= 1;
+
+  int index = 0;
+  int remainingLines = line;
+  for (; step > 0; step >>= 1) {
+    const int next = index + step;
+    if (next <= size && m_lineIndex[next] <= remainingLines) {
+      index = next;
+      remainingLines -= m_lineIndex[next];
     }
-
-    // half our stuff ;)
-    if (line < start)
-      blockEnd = middle - 1;
-    else
-      blockStart = middle + 1;
   }
 
   // we should always find a block
-  qFatal ("line requested in text buffer (%d out of [0, %d[), no block found", line, lines());
-  return -1;
+  if (index >= m_blocks.size())
+    qFatal ("line requested in text buffer (%d out of [0, %d[), no block found", line, lines());
+
+  // right block found, remember it and return it
+  m_lastUsedBlock = index;
+  return index;
+}
+
+int TextBuffer::startLineOfBlock (int blockIndex) const
+{
+  // only allow valid blocks
+  Q_ASSERT (blockIndex >= 0);
+  Q_ASSERT (blockIndex < m_lineIndex.size());
+
+  // sum up the line counts of all blocks in front of this one
+  int startLine = 0;
+  for (int i = blockIndex; i > 0; i -= (i & -i))
+    startLine += m_lineIndex[i];
+
+  return startLine;
 }
 
 void TextBuffer::fixStartLines (int startBlock)
@@ -442,18 +451,32 @@ void TextBuffer::fixStartLines (int startBlock)
   Q_ASSERT (startBlock >= 0);
   Q_ASSERT (startBlock < m_blocks.size());
 
-  // new start line for next block
-  TextBlock* block = m_blocks.at(startBlock);
-  int newStartLine = block->startLine () + block->lines ();
+  // compute change of the line count of this block, compared to the one in the index
+  const int indexedLines = startLineOfBlock (startBlock + 1) - startLineOfBlock (startBlock);
+  const int delta = m_blocks.at(startBlock)->lines () - indexedLines;
+  if (delta == 0)
+    return;
 
-  // fixup block
-  for (int index = startBlock + 1; index < m_blocks.size(); ++index) {
-    // set new start line
-    block = m_blocks.at(index);
-    block->setStartLine (newStartLine);
+  // update all index elements covering this block, start lines of all following blocks are fixed then
+  for (int i = startBlock + 1; i < m_lineIndex.size(); i += (i & -i))
+    m_lineIndex[i] += delta;
+}
 
-    // calculate next start line
-    newStartLine += block->lines ();
+void TextBuffer::rebuildLineIndex (int startBlock)
+{
+  // renumber the blocks
+  for (int index = startBlock; index < m_blocks.size(); ++index)
+    m_blocks.at(index)->setBlockIndex (index);
+
+  // build the index bottom up, each element adds itself to its parent
+  const int size = m_blocks.size();
+  m_lineIndex.fill (0, size + 1);
+  for (int i = 1; i <= size; ++i) {
+    m_lineIndex[i] += m_blocks.at(i-1)->lines ();
+
+    const int parent = i + (i & -i);
+    if (parent <= size)
+      m_lineIndex[parent] += m_lineIndex[i];
   }
 }
 
@@ -469,11 +492,15 @@ void TextBuffer::balanceBlock (int index)
     // half the block
     int halfSize = blockToBalance->lines () / 2;
 
-    // create and insert new block behind current one, already set right start line
+    // create and insert new block behind current one
     TextBlock *newBlock = blockToBalance->splitBlock (halfSize);
     Q_ASSERT (newBlock);
     m_blocks.insert (m_blocks.begin() + index + 1, newBlock);
 
+    // indices changed, after that the ranges can be fixed with the right start lines
+    rebuildLineIndex (index + 1);
+    blockToBalance->fixRangesAfterSplit (newBlock);
+
     // split is done
     return;
   }
@@ -498,6 +525,7 @@ void TextBuffer::balanceBlock (int index)
   // delete old block
   delete blockToBalance;
   m_blocks.erase (m_blocks.begin() + index);
+  rebuildLineIndex (index);
 }
 
 void TextBuffer::debugPrint (const QString &title) const
@@ -568,6 +596,7 @@ bool TextBuffer::load (const QString &filename, bool &encodingErrors, bool &tooL
       // create one dummy textline, in any case
       m_blocks.last()->appendLine (QString());
       m_lines++;
+      rebuildLineIndex (0);
       return false;
     }
 
@@ -637,7 +666,7 @@ bool TextBuffer::load (const QString &filename, bool &encodingErrors, bool &tooL
          * ensure blocks aren't too large
          */
         if (m_blocks.last()->lines() >= m_blockSize)
-            m_blocks.append (new TextBlock (this, m_blocks.last()->startLine() + m_blocks.last()->lines()));
+            m_blocks.append (new TextBlock (this, m_blocks.size()));
 
         /**
          * append line to last block
@@ -655,6 +684,9 @@ bool TextBuffer::load (const QString &filename, bool &encodingErrors, bool &tooL
     }
   }
 
+  // all blocks are filled, build line index
+  rebuildLineIndex (0);
+
   // save md5sum of file on disk
   setDigest (file.digest ());
 
@@ -779,7 +811,8 @@ bool TextBuffer::save (const QString &filename)
     // get line to save
     Kate::TextLine textline = line (i);
 
-    stream << textline->text();
+    // don't inflate compact lines just for saving
+    stream << textline->textCopy();
 
     // append correct end of line string
     if ((i+1) < m_lines)
@@ -869,40 +902,52 @@ void TextBuffer::markModifiedLinesAsSaved()
     block->markModifiedLinesAsSaved ();
 }
 
-QList<TextRange *> TextBuffer::rangesForLine (int line, KTextEditor::View *view, bool rangesWithAttributeOnly) const
+/**
+ * Append all ranges out of the given set which intersect the given line and match the view/attribute filter.
+ * Works directly on the sets of the block, no copies needed.
+ */
+static void appendRangesForLine (QList<TextRange *> &rightRanges, const QSet<TextRange *> &ranges, int line, KTextEditor::View *view, bool rangesWithAttributeOnly)
 {
-  // get block, this will assert on invalid line
-  const int blockIndex = blockForLine (line);
+  QSet<TextRange *>::const_iterator end = ranges.constEnd();
+  for (QSet<TextRange *>::const_iterator it = ranges.constBegin(); it != end; ++it) {
+    TextRange * const range = *it;
 
-  // get the ranges of the right block
-  QList<TextRange *> rightRanges;
-  foreach (const QSet<TextRange *> &ranges, m_blocks.at(blockIndex)->rangesForLine (line)) {
-    foreach (TextRange * const range, ranges) {
-        /**
-        * we want only ranges with attributes, but this one has none
-        */
-        if (rangesWithAttributeOnly && !range->hasAttribute())
-            continue;
+    /**
+    * we want only ranges with attributes, but this one has none
+    */
+    if (rangesWithAttributeOnly && !range->hasAttribute())
+        continue;
 
-        /**
-        * we want ranges for no view, but this one's attribute is only valid for views
-        */
-        if (!view && range->attributeOnlyForViews())
-            continue;
+    /**
+    * we want ranges for no view, but this one's attribute is only valid for views
+    */
+    if (!view && range->attributeOnlyForViews())
+        continue;
 
-        /**
-        * the range's attribute is not valid for this view
-        */
-        if (range->view() && range->view() != view)
-            continue;
+    /**
+    * the range's attribute is not valid for this view
+    */
+    if (range->view() && range->view() != view)
+        continue;
 
-        /**
-        * if line is in the range, ok
-        */
-        if (range->startInternal().lineInternal() <= line && line <= range->endInternal().lineInternal())
-          rightRanges.append (range);
-    }
+    /**
+    * if line is in the range, ok
+    */
+    if (range->startInternal().lineInternal() <= line && line <= range->endInternal().lineInternal())
+      rightRanges.append (range);
   }
+}
+
+QList<TextRange *> TextBuffer::rangesForLine (int line, KTextEditor::View *view, bool rangesWithAttributeOnly) const
+{
+  // get block, this will assert on invalid line
+  const TextBlock *block = m_blocks.at(blockForLine (line));
+
+  // get the ranges of the right block: multi-line ones + the cached single-line ones of this line
+  QList<TextRange *> rightRanges;
+  appendRangesForLine (rightRanges, block->uncachedRanges (), line, view, rangesWithAttributeOnly);
+  if (const QSet<TextRange *> *cachedRanges = block->cachedRangesForLine (line))
+    appendRangesForLine (rightRanges, *cachedRanges, line, view, rangesWithAttributeOnly);
 
   // return right ranges
   return rightRanges;
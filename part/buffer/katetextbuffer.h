@@ -160,6 +160,19 @@ class KATEPART_TESTS_EXPORT TextBuffer : public QObject {
      */
     void setLineLengthLimit (int lineLengthLimit) { m_lineLengthLimit = lineLengthLimit; }
 
+    /**
+     * Set whether loaded lines which are pure Latin-1 are stored as 8-bit data.
+     * Such lines are inflated to QString on first access, see TextLineData::compact().
+     * @param compactLineStorage store loaded lines compact?
+     */
+    void setCompactLineStorage (bool compactLineStorage) { m_compactLineStorage = compactLineStorage; }
+
+    /**
+     * Are loaded lines stored compact?
+     * @return compact line storage enabled?
+     */
+    bool compactLineStorage () const { return m_compactLineStorage; }
+
     /**
      * Load the given file. This will first clear the buffer and then load the file.
      * Even on error during loading the buffer will still be cleared.
@@ -362,17 +375,34 @@ class KATEPART_TESTS_EXPORT TextBuffer : public QObject {
   private:
     /**
      * Find block containing given line.
+     * Uses the line index, O(log blocks).
      * @param line we want to find block for this line
      * @return index of found block
      */
     int blockForLine (int line) const;
 
     /**
-     * Fix start lines of all blocks after the given one
+     * Start line of the block with the given index.
+     * Uses the line index, O(log blocks).
+     * @param blockIndex index of block
+     * @return start line of the block
+     */
+    int startLineOfBlock (int blockIndex) const;
+
+    /**
+     * Fix start lines of all blocks after the given one.
+     * The line count of the given block changed, this updates the line index, O(log blocks).
      * @param startBlock index of block from which we start to fix
      */
     void fixStartLines (int startBlock);
 
+    /**
+     * Renumber all blocks starting with the given one and rebuild the line index.
+     * Needed if blocks were inserted or removed, O(blocks).
+     * @param startBlock index of first block with changed index
+     */
+    void rebuildLineIndex (int startBlock);
+
     /**
      * Balance the given block. Look if it is too small or too large.
      * @param index block to balance
@@ -475,6 +505,13 @@ class KATEPART_TESTS_EXPORT TextBuffer : public QObject {
      */
     QVector<TextBlock *> m_blocks;
 
+    /**
+     * Line index over m_blocks, a binary indexed (Fenwick) tree of the line counts of the blocks.
+     * Element i (starting with 1) holds the sum of the line counts of the blocks ]i - lowbit(i), i].
+     * Allows to update line counts and to query start lines in O(log blocks).
+     */
+    QVector<int> m_lineIndex;
+
     /**
      * Number of lines in buffer
      */
@@ -567,6 +604,11 @@ class KATEPART_TESTS_EXPORT TextBuffer : public QObject {
      * Limit for line length, longer lines will be wrapped on load
      */
     int m_lineLengthLimit;
+
+    /**
+     * Store loaded lines compact if possible?
+     */
+    bool m_compactLineStorage;
 };
 
 }
@@ -63,7 +63,8 @@ TextCursor::~TextCursor ()
 
 void TextCursor::setPosition( const TextCursor& position )
 {
-    if (m_block && m_block != position.m_block)
+    // remove in any case, the cursors of a block are sorted by position
+    if (m_block)
         m_block->removeCursor (this);
 
     m_line = position.m_line;
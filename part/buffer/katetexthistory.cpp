@@ -53,6 +53,7 @@ void TextHistory::clear ()
 
   // first entry will again belong to first revision
   m_firstHistoryEntryRevision = 0;
+  m_historyEntries.first().revision = m_firstHistoryEntryRevision;
 }
 
 void TextHistory::setLastSavedRevision ()
@@ -127,6 +128,7 @@ void TextHistory::addEntry (const Entry &entry)
      * remember edit
      */
     m_historyEntries.first() = entry;
+    m_historyEntries.first().revision = m_firstHistoryEntryRevision;
 
     /**
      * be done...
@@ -134,10 +136,88 @@ void TextHistory::addEntry (const Entry &entry)
     return;
   }
 
+  /**
+   * if nobody locked the current revision, nobody can transform from or to it
+   * try to merge the new edit into the last one, this keeps the history short while typing
+   * the first entry is never merged, transformations never apply it
+   */
+  Entry &lastEntry = m_historyEntries.last ();
+  if ((m_historyEntries.size () > 1) && !lastEntry.referenceCounter && lastEntry.merge (entry)) {
+    lastEntry.revision = revision () + 1;
+    return;
+  }
+
   /**
    * ok, we have more than one entry or the entry is referenced, just add up new entries
    */
   m_historyEntries.push_back (entry);
+  m_historyEntries.last().revision = revision () + 1;
+}
+
+int TextHistory::entryForRevision (qint64 revision) const
+{
+  /**
+   * binary search, revisions are sorted
+   */
+  int first = 0;
+  int last = m_historyEntries.size() - 1;
+  while (first < last) {
+    const int middle = first + (last - first) / 2;
+    if (m_historyEntries.at(middle).revision < revision)
+      first = middle + 1;
+    else
+      last = middle;
+  }
+
+  /**
+   * revision must be in the history
+   */
+  Q_ASSERT (m_historyEntries.at(first).revision == revision);
+  return first;
+}
+
+bool TextHistory::Entry::merge (const Entry &entry)
+{
+  /**
+   * only merge changes of the same kind in the same line
+   */
+  if (type != entry.type || line != entry.line)
+    return false;
+
+  switch (type) {
+    /**
+     * continued typing, the new text directly follows the last one
+     */
+    case InsertText:
+      if (entry.column != column + length)
+        return false;
+
+      length += entry.length;
+      return true;
+
+    /**
+     * continued delete or backspace, the new range touches the last one
+     */
+    case RemoveText:
+      if (entry.column == column) {
+        length += entry.length;
+        return true;
+      }
+
+      if (entry.column + entry.length == column) {
+        column = entry.column;
+        length += entry.length;
+        return true;
+      }
+
+      return false;
+
+    /**
+     * wrap/unwrap are not merged
+     */
+    default:
+      return false;
+  }
 }
 
 void TextHistory::lockRevision (qint64 revision)
@@ -147,12 +227,12 @@ void TextHistory::lockRevision (qint64 revision)
    */
   Q_ASSERT (!m_historyEntries.empty ());
   Q_ASSERT (revision >= m_firstHistoryEntryRevision);
-  Q_ASSERT (revision < (m_firstHistoryEntryRevision + m_historyEntries.size()));
+  Q_ASSERT (revision <= m_historyEntries.last().revision);
 
   /**
    * increment revision reference counter
    */
-  Entry &entry = m_historyEntries[revision - m_firstHistoryEntryRevision];
+  Entry &entry = m_historyEntries[entryForRevision (revision)];
   ++entry.referenceCounter;
 }
 
@@ -163,12 +243,12 @@ void TextHistory::unlockRevision (qint64 revision)
    */
   Q_ASSERT (!m_historyEntries.empty ());
   Q_ASSERT (revision >= m_firstHistoryEntryRevision);
-  Q_ASSERT (revision < (m_firstHistoryEntryRevision + m_historyEntries.size()));
+  Q_ASSERT (revision <= m_historyEntries.last().revision);
 
   /**
    * decrement revision reference counter
    */
-  Entry &entry = m_historyEntries[revision - m_firstHistoryEntryRevision];
+  Entry &entry = m_historyEntries[entryForRevision (revision)];
   Q_ASSERT (entry.referenceCounter);
   --entry.referenceCounter;
 
@@ -196,7 +276,7 @@ void TextHistory::unlockRevision (qint64 revision)
       m_historyEntries.erase (m_historyEntries.begin(), m_historyEntries.begin() + unreferencedEdits);
 
       // patch first entry revision
-      m_firstHistoryEntryRevision += unreferencedEdits;
+      m_firstHistoryEntryRevision = m_historyEntries.first().revision;
     }
   }
 }
@@ -456,9 +536,15 @@ void TextHistory::transformCursor (int& line, int& column, KTextEditor::MovingCu
   Q_ASSERT (!m_historyEntries.empty ());
   Q_ASSERT (fromRevision != toRevision);
   Q_ASSERT (fromRevision >= m_firstHistoryEntryRevision);
-  Q_ASSERT (fromRevision < (m_firstHistoryEntryRevision + m_historyEntries.size()));
+  Q_ASSERT (fromRevision <= m_historyEntries.last().revision);
   Q_ASSERT (toRevision >= m_firstHistoryEntryRevision);
-  Q_ASSERT (toRevision < (m_firstHistoryEntryRevision + m_historyEntries.size()));
+  Q_ASSERT (toRevision <= m_historyEntries.last().revision);
+
+  /**
+   * entries for the revisions, merged entries span multiple revisions
+   */
+  const int fromEntry = entryForRevision (fromRevision);
+  const int toEntry = entryForRevision (toRevision);
 
   /**
    * transform cursor
@@ -469,12 +555,12 @@ void TextHistory::transformCursor (int& line, int& column, KTextEditor::MovingCu
    * forward or reverse transform?
    */
   if (toRevision > fromRevision) {
-    for (int rev = fromRevision - m_firstHistoryEntryRevision + 1; rev <= (toRevision - m_firstHistoryEntryRevision); ++rev) {
+    for (int rev = fromEntry + 1; rev <= toEntry; ++rev) {
         const Entry &entry = m_historyEntries.at(rev);
         entry.transformCursor (line, column, moveOnInsert);
     }
   } else {
-    for (int rev = fromRevision - m_firstHistoryEntryRevision; rev >= (toRevision - m_firstHistoryEntryRevision + 1); --rev) {
+    for (int rev = fromEntry; rev >= toEntry + 1; --rev) {
         const Entry &entry = m_historyEntries.at(rev);
         entry.reverseTransformCursor (line, column, moveOnInsert);
     }
@@ -513,9 +599,15 @@ void TextHistory::transformRange (KTextEditor::Range &range, KTextEditor::Moving
   Q_ASSERT (!m_historyEntries.empty ());
   Q_ASSERT (fromRevision != toRevision);
   Q_ASSERT (fromRevision >= m_firstHistoryEntryRevision);
-  Q_ASSERT (fromRevision < (m_firstHistoryEntryRevision + m_historyEntries.size()));
+  Q_ASSERT (fromRevision <= m_historyEntries.last().revision);
   Q_ASSERT (toRevision >= m_firstHistoryEntryRevision);
-  Q_ASSERT (toRevision < (m_firstHistoryEntryRevision + m_historyEntries.size()));
+  Q_ASSERT (toRevision <= m_historyEntries.last().revision);
+
+  /**
+   * entries for the revisions, merged entries span multiple revisions
+   */
+  const int fromEntry = entryForRevision (fromRevision);
+  const int toEntry = entryForRevision (toRevision);
   
   /**
    * transform cursors
@@ -531,7 +623,7 @@ void TextHistory::transformRange (KTextEditor::Range &range, KTextEditor::Moving
    * forward or reverse transform?
    */
   if (toRevision > fromRevision) {
-    for (int rev = fromRevision - m_firstHistoryEntryRevision + 1; rev <= (toRevision - m_firstHistoryEntryRevision); ++rev) {
+    for (int rev = fromEntry + 1; rev <= toEntry; ++rev) {
         const Entry &entry = m_historyEntries.at(rev);
         
         entry.transformCursor (startLine, startColumn, moveOnInsertStart);
@@ -553,7 +645,7 @@ void TextHistory::transformRange (KTextEditor::Range &range, KTextEditor::Moving
         }
     }
   } else {
-    for (int rev = fromRevision - m_firstHistoryEntryRevision ; rev >= (toRevision - m_firstHistoryEntryRevision + 1); --rev) {
+    for (int rev = fromEntry; rev >= toEntry + 1; --rev) {
         const Entry &entry = m_historyEntries.at(rev);
         
         entry.reverseTransformCursor (startLine, startColumn, moveOnInsertStart);
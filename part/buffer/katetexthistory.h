@@ -108,6 +108,14 @@ class KATEPART_TESTS_EXPORT TextHistory {
          */
         void reverseTransformCursor (int &line, int &column, bool moveOnInsert) const;
 
+        /**
+         * Try to merge the given entry into this one, it must directly follow this one.
+         * Only continued typing and continued backspace/delete on the same line are merged.
+         * @param entry entry following this one
+         * @return true if the entry was merged, then this entry describes both changes
+         */
+        bool merge (const Entry &entry);
+
         /**
          * Types of entries, matching editing primitives of buffer and placeholder
          */
@@ -123,7 +131,7 @@ class KATEPART_TESTS_EXPORT TextHistory {
          * Default Constructor, invalidates all fields
          */
         Entry ()
-         : referenceCounter (0), type (NoChange), line (-1), column (-1), length (-1), oldLineLength (-1)
+         : referenceCounter (0), revision (-1), type (NoChange), line (-1), column (-1), length (-1), oldLineLength (-1)
         {
         }
 
@@ -132,6 +140,12 @@ class KATEPART_TESTS_EXPORT TextHistory {
          */
         unsigned int referenceCounter;
 
+        /**
+         * Revision the buffer has after this change.
+         * Merged entries span multiple revisions, then this is the last one.
+         */
+        qint64 revision;
+
         /**
          * Type of change
          */
@@ -213,6 +227,14 @@ class KATEPART_TESTS_EXPORT TextHistory {
      */
     void addEntry (const Entry &entry);
 
+    /**
+     * Find the history entry for the given revision.
+     * The revision must be in the history, revisions inside of merged entries are not.
+     * @param revision revision to search
+     * @return index of the entry with this revision in m_historyEntries
+     */
+    int entryForRevision (qint64 revision) const;
+
   private:
     /**
      * TextBuffer this history belongs to
@@ -226,6 +248,7 @@ class KATEPART_TESTS_EXPORT TextHistory {
 
     /**
      * history of edits
+     * consecutive edits of the same kind are merged, if no revision in between is locked
      */
     QList<Entry> m_historyEntries;
 
@@ -22,6 +22,56 @@
 
 namespace Kate {
 
+/**
+ * Memory of deleted text lines, linked through the memory itself.
+ * Bounded, we don't want to hold the memory of a closed large file forever.
+ */
+struct FreeTextLineData
+{
+  FreeTextLineData *next;
+};
+
+static FreeTextLineData *freeTextLineData = 0;
+static int freeTextLineDataSize = 0;
+static const int maximalFreeTextLineDataSize = 4096;
+
+quint64 TextLineData::s_heapAllocations = 0;
+quint64 TextLineData::s_recycledAllocations = 0;
+
+void *TextLineData::operator new (size_t size)
+{
+  Q_ASSERT (size == sizeof (TextLineData));
+
+  // recycle memory of a deleted line, if any around
+  if (freeTextLineData) {
+    FreeTextLineData *memory = freeTextLineData;
+    freeTextLineData = memory->next;
+    --freeTextLineDataSize;
+    ++s_recycledAllocations;
+    return memory;
+  }
+
+  ++s_heapAllocations;
+  return ::operator new (size);
+}
+
+void TextLineData::operator delete (void *memory)
+{
+  if (!memory)
+    return;
+
+  // pool full, give memory back
+  if (freeTextLineDataSize >= maximalFreeTextLineDataSize) {
+    ::operator delete (memory);
+    return;
+  }
+
+  FreeTextLineData *freeMemory = static_cast<FreeTextLineData *> (memory);
+  freeMemory->next = freeTextLineData;
+  freeTextLineData = freeMemory;
+  ++freeTextLineDataSize;
+}
+
 TextLineData::TextLineData ()
   : m_flags (0)
 {
@@ -37,6 +87,33 @@ TextLineData::~TextLineData ()
 {
 }
 
+bool TextLineData::compact ()
+{
+  if (!m_compactText.isNull())
+    return true;
+
+  // nothing to gain for empty lines
+  const int len = m_text.length();
+  if (len == 0)
+    return false;
+
+  // only pure Latin-1 text without null characters can be stored as 8-bit data
+  const ushort *unicode = m_text.utf16();
+  for (int i = 0; i < len; ++i)
+    if (unicode[i] == 0 || unicode[i] > 0xff)
+      return false;
+
+  m_compactText = m_text.toLatin1();
+  m_text = QString();
+  return true;
+}
+
+void TextLineData::inflate () const
+{
+  m_text = QString::fromLatin1 (m_compactText.constData(), m_compactText.size());
+  m_compactText = QByteArray();
+}
+
 int TextLineData::firstChar() const
 {
   return nextNonSpaceChar(0);
@@ -44,15 +121,17 @@ int TextLineData::firstChar() const
 
 int TextLineData::lastChar() const
 {
-  return previousNonSpaceChar(m_text.length() - 1);
+  return previousNonSpaceChar(length() - 1);
 }
 
 int TextLineData::nextNonSpaceChar (int pos) const
 {
   Q_ASSERT (pos >= 0);
 
-  for(int i = pos; i < m_text.length(); i++)
-    if (!m_text[i].isSpace())
+  // at() and length() don't inflate compact stored text
+  const int len = length();
+  for(int i = pos; i < len; i++)
+    if (!at(i).isSpace())
       return i;
 
   return -1;
@@ -60,11 +139,11 @@ int TextLineData::nextNonSpaceChar (int pos) const
 
 int TextLineData::previousNonSpaceChar (int pos) const
 {
-  if (pos >= m_text.length())
-    pos = m_text.length() - 1;
+  if (pos >= length())
+    pos = length() - 1;
 
   for(int i = pos; i >= 0; i--)
-    if (!m_text[i].isSpace())
+    if (!at(i).isSpace())
       return i;
 
   return -1;
@@ -81,14 +160,14 @@ QString TextLineData::leadingWhitespace() const
 int TextLineData::indentDepth (int tabWidth) const
 {
   int d = 0;
-  const int len = m_text.length();
-  const QChar *unicode = m_text.unicode();
+  const int len = length();
 
   for(int i = 0; i < len; ++i)
   {
-    if(unicode[i].isSpace())
+    const QChar c = at(i);
+    if(c.isSpace())
     {
-      if (unicode[i] == QLatin1Char('\t'))
+      if (c == QLatin1Char('\t'))
         d += tabWidth - (d % tabWidth);
       else
         d++;
@@ -105,17 +184,16 @@ bool TextLineData::matchesAt(int column, const QString& match) const
   if (column < 0)
     return false;
 
-  const int len = m_text.length();
+  const int len = length();
   const int matchlen = match.length();
 
   if ((column + matchlen) > len)
     return false;
 
-  const QChar *unicode = m_text.unicode();
   const QChar *matchUnicode = match.unicode();
 
   for (int i=0; i < matchlen; ++i)
-    if (unicode[i+column] != matchUnicode[i])
+    if (at(i+column) != matchUnicode[i])
       return false;
 
   return true;
@@ -127,12 +205,11 @@ int TextLineData::toVirtualColumn (int column, int tabWidth) const
     return 0;
 
   int x = 0;
-  const int zmax = qMin(column, m_text.length());
-  const QChar *unicode = m_text.unicode();
+  const int zmax = qMin(column, length());
 
   for ( int z = 0; z < zmax; ++z)
   {
-    if (unicode[z] == QLatin1Char('\t'))
+    if (at(z) == QLatin1Char('\t'))
       x += tabWidth - (x % tabWidth);
     else
       x++;
@@ -146,15 +223,14 @@ int TextLineData::fromVirtualColumn (int column, int tabWidth) const
   if (column < 0)
     return 0;
 
-  const int zmax = qMin(m_text.length(), column);
-  const QChar *unicode = m_text.unicode();
+  const int zmax = qMin(length(), column);
 
   int x = 0;
   int z = 0;
   for (; z < zmax; ++z)
   {
     int diff = 1;
-    if (unicode[z] == QLatin1Char('\t'))
+    if (at(z) == QLatin1Char('\t'))
       diff = tabWidth - (x % tabWidth);
 
     if (x + diff > column)
@@ -168,12 +244,11 @@ int TextLineData::fromVirtualColumn (int column, int tabWidth) const
 int TextLineData::virtualLength (int tabWidth) const
 {
   int x = 0;
-  const int len = m_text.length();
-  const QChar *unicode = m_text.unicode();
+  const int len = length();
 
   for ( int z = 0; z < len; ++z)
   {
-    if (unicode[z] == QLatin1Char('\t'))
+    if (at(z) == QLatin1Char('\t'))
       x += tabWidth - (x % tabWidth);
     else
       x++;
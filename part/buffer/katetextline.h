@@ -23,6 +23,7 @@
 
 #include <QtCore/QVector>
 #include <QtCore/QString>
+#include <QtCore/QByteArray>
 #include <QtCore/QSharedPointer>
 
 #include "katepartprivate_export.h"
@@ -116,11 +117,82 @@ class KATEPART_TESTS_EXPORT TextLineData {
      */
     ~TextLineData ();
 
+    /**
+     * Allocate memory for a text line.
+     * Memory of deleted lines is recycled, as lines are replaced on each wrap/unwrap.
+     * @param size size of memory to allocate, must be sizeof(TextLineData)
+     * @return allocated memory
+     */
+    static void *operator new (size_t size);
+
+    /**
+     * Free memory of a text line, it is kept for recycling if the pool is not full.
+     * @param memory memory to free
+     */
+    static void operator delete (void *memory);
+
+    /**
+     * Number of text line allocations which needed new memory from the heap.
+     * @return heap allocations since program start
+     */
+    static quint64 heapAllocations () { return s_heapAllocations; }
+
+    /**
+     * Number of text line allocations which recycled memory of deleted lines.
+     * @return recycled allocations since program start
+     */
+    static quint64 recycledAllocations () { return s_recycledAllocations; }
+
     /**
      * Accessor to the text contained in this line.
+     * Inflates compact stored text, see compact().
      * @return text of this line as constant reference
      */
-    const QString &text () const { return m_text; }
+    const QString &text () const
+    {
+      if (!m_compactText.isNull())
+        inflate ();
+
+      return m_text;
+    }
+
+    /**
+     * Copy of the text contained in this line.
+     * Unlike text(), this won't inflate compact stored text, use it for one-shot accesses to many lines.
+     * @return text of this line
+     */
+    QString textCopy () const
+    {
+      if (!m_compactText.isNull())
+        return QString::fromLatin1 (m_compactText.constData(), m_compactText.size());
+
+      return m_text;
+    }
+
+    /**
+     * Store the text of this line as 8-bit data, if it is pure Latin-1.
+     * The text is inflated again on the first call of text() or on write access.
+     * @return text stored compact?
+     */
+    bool compact ();
+
+    /**
+     * Is the text of this line stored compact?
+     * @return text stored as 8-bit data?
+     */
+    bool isCompact () const { return !m_compactText.isNull(); }
+
+    /**
+     * Bytes used for the text payload of this line, for memory statistics.
+     * @return allocated bytes of text data
+     */
+    int textMemoryUsage () const
+    {
+      if (!m_compactText.isNull())
+        return m_compactText.capacity();
+
+      return m_text.capacity() * sizeof(QChar);
+    }
 
     /**
      * Returns the position of the first non-whitespace character
@@ -158,8 +230,8 @@ class KATEPART_TESTS_EXPORT TextLineData {
      */
     inline QChar at (int column) const
     {
-      if (column >= 0 && column < m_text.length())
-        return m_text[column];
+      if (column >= 0 && column < length())
+        return m_compactText.isNull() ? m_text[column] : QChar (uchar (m_compactText[column]));
 
       return QChar();
     }
@@ -171,10 +243,7 @@ class KATEPART_TESTS_EXPORT TextLineData {
      */
     inline QChar operator[](int column) const
     {
-      if (column >= 0 && column < m_text.length())
-        return m_text[column];
-
-      return QChar();
+      return at (column);
     }
 
     inline void markAsModified(bool modified)
@@ -263,7 +332,7 @@ class KATEPART_TESTS_EXPORT TextLineData {
     /**
      * Returns the line's length.
      */
-    int length() const { return m_text.length(); }
+    int length() const { return m_compactText.isNull() ? m_text.length() : m_compactText.size(); }
 
     /**
      * Returns \e true, if the line's hl-continue flag is set, otherwise returns
@@ -283,7 +352,7 @@ class KATEPART_TESTS_EXPORT TextLineData {
      * Returns the complete text line (as a QString reference).
      * @return text of this line, read-only
      */
-    const QString& string() const { return m_text; }
+    const QString& string() const { return text(); }
 
     /**
      * Returns the substring with \e length beginning at the given \e column.
@@ -292,7 +361,7 @@ class KATEPART_TESTS_EXPORT TextLineData {
      * @return wanted part of text
      */
     QString string (int column, int length) const
-    { return m_text.mid(column, length); }
+    { return text().mid(column, length); }
 
     /**
      * Leading whitespace of this line
@@ -330,12 +399,12 @@ class KATEPART_TESTS_EXPORT TextLineData {
     /**
      * Returns \e true, if the line starts with \e match, otherwise returns \e false.
      */
-    bool startsWith(const QString& match) const { return m_text.startsWith (match); }
+    bool startsWith(const QString& match) const { return text().startsWith (match); }
 
     /**
      * Returns \e true, if the line ends with \e match, otherwise returns \e false.
      */
-    bool endsWith(const QString& match) const { return m_text.endsWith (match); }
+    bool endsWith(const QString& match) const { return text().endsWith (match); }
 
     /**
      * context stack
@@ -357,8 +426,15 @@ class KATEPART_TESTS_EXPORT TextLineData {
 
     /**
      * Clear attributes of this line
+     * The memory is kept, highlighting will fill in nearly the same amount of attributes again.
      */
-    void clearAttributes () { m_attributesList.clear (); }
+    void clearAttributes ()
+    {
+      if (!m_attributesList.isDetached ())
+        m_attributesList.clear ();
+      else if (!m_attributesList.isEmpty ())
+        m_attributesList.erase (m_attributesList.begin (), m_attributesList.end ());
+    }
 
     /**
      * Accessor to attributes
@@ -375,13 +451,29 @@ class KATEPART_TESTS_EXPORT TextLineData {
      */
     short attribute (int pos) const
     {
-      for (int i=0; i < m_attributesList.size(); ++i)
+      /**
+       * the attributes are sorted by offset and don't overlap
+       * binary search for the first attribute starting behind pos
+       */
+      int first = 0;
+      int last = m_attributesList.size();
+      while (first < last)
       {
-        if (pos >= m_attributesList[i].offset && pos < (m_attributesList[i].offset + m_attributesList[i].length))
-          return m_attributesList[i].attributeValue;
+        const int middle = (first + last) / 2;
+        if (m_attributesList[middle].offset <= pos)
+          first = middle + 1;
+        else
+          last = middle;
+      }
 
-        if (pos < m_attributesList[i].offset)
-          break;
+      /**
+       * only the last non-empty attribute in front of it may contain pos
+       * empty ones, like the begin of folding regions, are skipped
+       */
+      for (int i = first - 1; i >= 0; --i)
+      {
+        if (m_attributesList[i].length > 0)
+          return (pos < (m_attributesList[i].offset + m_attributesList[i].length)) ? m_attributesList[i].attributeValue : 0;
       }
 
       return 0;
@@ -413,13 +505,29 @@ class KATEPART_TESTS_EXPORT TextLineData {
      * This accessor is private, only the friend class text buffer/block is allowed to access the text read/write.
      * @return text of this line
      */
-    QString &textReadWrite () { return m_text; }
+    QString &textReadWrite ()
+    {
+      if (!m_compactText.isNull())
+        inflate ();
+
+      return m_text;
+    }
+
+    /**
+     * Convert compact stored text back to a QString.
+     */
+    void inflate () const;
 
   private:
     /**
-     * text of this line
+     * text of this line, empty if stored compact
      */
-    QString m_text;
+    mutable QString m_text;
+
+    /**
+     * text of this line as Latin-1, only set if stored compact
+     */
+    mutable QByteArray m_compactText;
 
     /**
      * attributes of this line
@@ -435,6 +543,12 @@ class KATEPART_TESTS_EXPORT TextLineData {
      * flags of this line
      */
     unsigned int m_flags;
+
+    /**
+     * allocation counters, see heapAllocations() and recycledAllocations()
+     */
+    static quint64 s_heapAllocations;
+    static quint64 s_recycledAllocations;
 };
 
 /**
@@ -245,8 +245,9 @@ class TextLoader
               QString unicode = m_codec->toUnicode (m_buffer.constData() + bomBytes, c - bomBytes, m_converterState);
 
               // detect broken encoding
+              const ushort *unicodeData = unicode.utf16 ();
               for (int i = 0; i < unicode.size(); ++i) {
-                  if (unicode[i] == 0) {
+                  if (unicodeData[i] == 0) {
                     encodingError = true;
                     break;
                   }
@@ -284,6 +285,27 @@ class TextLoader
 	  }
         }
 
+        /**
+         * fast path: skip all characters that can't end a line in one go
+         * only \n, \r and the unicode line separator need the handling below
+         */
+        const ushort *text = m_text.utf16 ();
+        const int textLength = m_text.length ();
+        int scan = m_position;
+        while (scan < textLength) {
+          const ushort ch = text[scan];
+          if ((ch <= '\r') ? (ch == '\r' || ch == '\n') : (ch == QChar::LineSeparator))
+            break;
+          ++scan;
+        }
+
+        if (scan > m_position) {
+          m_lastWasEndOfLine = false;
+          m_lastWasR = false;
+          m_position = scan;
+          continue;
+        }
+
         if (m_text.at(m_position) == lf)
         {
           m_lastWasEndOfLine = true;
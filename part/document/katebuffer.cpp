@@ -44,6 +44,7 @@
 
 #include <QtCore/QFile>
 #include <QtCore/QTextStream>
+#include <QtCore/QTime>
 #include <QtCore/QTimer>
 #include <QtCore/QTextCodec>
 #include <QtCore/QDate>
@@ -55,6 +56,16 @@
  */
 static const int KATE_MAX_DYNAMIC_CONTEXTS = 512;
 
+/**
+ * Time in ms to highlight in the background before returning to the event loop
+ */
+static const int KATE_HL_BACKGROUND_TIME_SLICE = 5;
+
+/**
+ * Lines to highlight in the background between two time checks
+ */
+static const int KATE_HL_BACKGROUND_CHUNK = 64;
+
 /**
  * Create an empty buffer. (with one block with one empty line)
  */
@@ -66,10 +77,16 @@ KateBuffer::KateBuffer(KateDocument *doc)
    m_highlight (0),
    m_tabWidth (8),
    m_lineHighlighted (0),
+   m_lineCheckpointsEnd (0),
    m_maxDynamicContexts (KATE_MAX_DYNAMIC_CONTEXTS)
 {
   // we need kate global to stay alive
   KateGlobal::incRef ();
+
+  // background highlighting, runs when the event loop is idle
+  m_highlightTimer.setSingleShot (true);
+  m_highlightTimer.setInterval (0);
+  connect (&m_highlightTimer, SIGNAL(timeout()), this, SLOT(highlightInBackground()));
 }
 
 /**
@@ -118,6 +135,13 @@ void KateBuffer::editEnd ()
   if (!m_highlight)
     return;
 
+  /**
+   * changed lines behind the highlighted area are no checkpoints anymore
+   * the line in front of them neither, its indentation based folding depends on them
+   */
+  if (editingMaximalLineChanged () >= m_lineHighlighted)
+    m_lineCheckpointsEnd = qMin (m_lineCheckpointsEnd, editingMinimalLineChanged () - 1);
+
   /**
    * if we don't touch the highlighted area => fine
    */
@@ -156,6 +180,7 @@ void KateBuffer::clear()
 
   // back to line 0 with hl
   m_lineHighlighted = 0;
+  m_lineCheckpointsEnd = 0;
 }
 
 bool KateBuffer::openFile (const QString &m_file, bool enforceTextCodec)
@@ -174,6 +199,9 @@ bool KateBuffer::openFile (const QString &m_file, bool enforceTextCodec)
   // line length limit
   setLineLengthLimit (m_doc->config()->lineLengthLimit());
 
+  // keep pure Latin-1 lines as 8-bit data until they are needed
+  setCompactLineStorage (true);
+
   // then, try to load the file
   m_brokenEncoding = false;
   m_tooLongLinesWrapped = false;
@@ -296,6 +324,27 @@ void KateBuffer::ensureHighlighted (int line, int lookAhead)
 
   // ensure we have enough highlighted
   doHighlight ( m_lineHighlighted, end, false );
+
+  // highlight the rest of the document later
+  if (m_lineHighlighted < lines () && !m_highlightTimer.isActive ())
+    m_highlightTimer.start ();
+}
+
+void KateBuffer::highlightInBackground ()
+{
+  // no hl around or nobody looks at the document, no stuff to do
+  if (!m_highlight || m_highlight->noHighlighting() || m_doc->views().isEmpty())
+    return;
+
+  // highlight chunks of lines until the time slice is used up
+  QTime t;
+  t.start ();
+  while (m_lineHighlighted < lines () && t.elapsed () < KATE_HL_BACKGROUND_TIME_SLICE)
+    doHighlight ( m_lineHighlighted, qMin (m_lineHighlighted + KATE_HL_BACKGROUND_CHUNK, lines ()) - 1, false );
+
+  // still lines left, continue next time the event loop is idle
+  if (m_lineHighlighted < lines ())
+    m_highlightTimer.start ();
 }
 
 void KateBuffer::wrapLine (const KTextEditor::Cursor &position)
@@ -303,8 +352,17 @@ void KateBuffer::wrapLine (const KTextEditor::Cursor &position)
   // call original
   Kate::TextBuffer::wrapLine (position);
 
-  if (m_lineHighlighted > position.line()+1)
+  if (m_lineHighlighted > position.line()+1) {
     m_lineHighlighted++;
+
+    // checkpoints are all behind the wrapped line, move them
+    if (m_lineCheckpointsEnd > m_lineHighlighted)
+      m_lineCheckpointsEnd++;
+  }
+
+  // the wrapped line and the one in front of it are no checkpoints anymore
+  else
+    m_lineCheckpointsEnd = qMin (m_lineCheckpointsEnd, position.line() - 1);
 }
 
 void KateBuffer::unwrapLines (int from, int to)
@@ -316,6 +374,7 @@ void KateBuffer::unwrapLines (int from, int to)
   for (int line = to; line >= from; --line) {
       if (line + 1 < lines()) {
           Kate::TextBuffer::unwrapLine (line + 1);
+          fixCheckpointsForUnwrap (line + 1);
         
           if (m_lineHighlighted > (line + 1))
             --m_lineHighlighted;
@@ -327,6 +386,7 @@ void KateBuffer::unwrapLines (int from, int to)
       // line can't be unwraped without it
       else if (line) {
           Kate::TextBuffer::unwrapLine (line);
+          fixCheckpointsForUnwrap (line);
         
           if (m_lineHighlighted > line)
             --m_lineHighlighted;
@@ -338,11 +398,25 @@ void KateBuffer::unwrapLine (int line)
 {
   // reimplemented, so first call original
   Kate::TextBuffer::unwrapLine (line);
+  fixCheckpointsForUnwrap (line);
 
   if (m_lineHighlighted > line)
     --m_lineHighlighted;
 }
 
+void KateBuffer::fixCheckpointsForUnwrap (int line)
+{
+  // checkpoints are all behind the unwrapped line, move them
+  if (m_lineHighlighted > line) {
+    if (m_lineCheckpointsEnd > m_lineHighlighted)
+      --m_lineCheckpointsEnd;
+  }
+
+  // the line we appended to and the one in front of it are no checkpoints anymore
+  else
+    m_lineCheckpointsEnd = qMin (m_lineCheckpointsEnd, line - 2);
+}
+
 void KateBuffer::setTabWidth (int w)
 {
   if ((m_tabWidth != w) && (m_tabWidth > 0))
@@ -389,6 +463,7 @@ void KateBuffer::setHighlight(int hlMode)
 void KateBuffer::invalidateHighlighting()
 {
   m_lineHighlighted = 0;
+  m_lineCheckpointsEnd = 0;
 }
 
 void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
@@ -402,14 +477,14 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
   t.start();
   kDebug (13020) << "HIGHLIGHTED START --- NEED HL, LINESTART: " << startLine << " LINEEND: " << endLine;
   kDebug (13020) << "HL UNTIL LINE: " << m_lineHighlighted;
-  kDebug (13020) << "HL DYN COUNT: " << KateHlManager::self()->countDynamicCtxs() << " MAX: " << m_maxDynamicContexts;
+  kDebug (13020) << "HL DYN COUNT: " << m_highlight->dynamicContextsCount() << " MAX: " << m_maxDynamicContexts;
 #endif
 
-  // see if there are too many dynamic contexts; if yes, invalidate HL of all documents
-  if (KateHlManager::self()->countDynamicCtxs() >= m_maxDynamicContexts)
+  // see if there are too many dynamic contexts; if yes, invalidate HL of all documents using our hl
+  if (m_highlight->dynamicContextsCount() >= m_maxDynamicContexts)
   {
     {
-      if (KateHlManager::self()->resetDynamicCtxs())
+      if (KateHlManager::self()->resetDynamicCtxs(m_highlight))
       {
 #ifdef BUFFER_DEBUGGING
         kDebug (13020) << "HL invalidated - too many dynamic contexts ( >= " << m_maxDynamicContexts << ")";
@@ -418,8 +493,10 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
         // avoid recursive invalidation
         KateHlManager::self()->setForceNoDCReset(true);
 
+        // the dynamic contexts are owned by our hl, documents with other hls keep their highlighting
         foreach(KateDocument* doc, KateGlobal::self()->kateDocuments())
-          doc->makeAttribs();
+          if (doc->highlight() == m_highlight)
+            doc->makeAttribs();
 
         // doHighlight *shall* do his work. After invalidation, some highlight has
         // been recalculated, but *maybe not* until endLine ! So we shall force it manually...
@@ -443,6 +520,9 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
   // if possible get previous line, otherwise create 0 line.
   Kate::TextLine prevLine = (startLine >= 1) ? plainLine (startLine - 1) : Kate::TextLine ();
 
+  // remember the highlighted area we started with
+  const int oldHighlighted = m_lineHighlighted;
+
   // here we are atm, start at start line in the block
   int current_line = startLine;
   int start_spellchecking = -1;
@@ -450,6 +530,9 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
   bool ctxChanged = false;
   Kate::TextLine textLine = plainLine (current_line);
   Kate::TextLine nextLine;
+
+  // shared empty line, used as next line for the last line of the document
+  static const Kate::TextLine emptyLine (new Kate::TextLineData ());
   // loop over the lines of the block, from startline to endline or end of block
   // if stillcontinue forces us to do so
   for (; current_line < qMin (endLine+1, lines()); ++current_line)
@@ -458,8 +541,9 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
     if ((current_line + 1) < lines())
       nextLine = plainLine (current_line+1);
     else
-      nextLine = Kate::TextLine (new Kate::TextLineData ());
+      nextLine = emptyLine;
     
+    const bool oldHlLineContinue = textLine->hlLineContinue ();
     ctxChanged = false;
     m_highlight->doHighlight (prevLine.data(), textLine.data(), nextLine.data(), ctxChanged, tabWidth());
 
@@ -485,6 +569,17 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
       last_line_spellchecking=current_line;
     }
 
+    /**
+     * behind the highlighted area this line ended with the same state as stored before:
+     * all checkpoints behind it are valid again, skip them
+     */
+    if (!ctxChanged && (oldHlLineContinue == textLine->hlLineContinue ())
+        && (current_line >= oldHighlighted) && ((current_line + 1) < m_lineCheckpointsEnd)) {
+      current_line = m_lineCheckpointsEnd - 1;
+      textLine = plainLine (current_line);
+      nextLine = plainLine (current_line + 1);
+    }
+
     // move around the lines
     prevLine = textLine;
     textLine = nextLine;
@@ -492,10 +587,14 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
 
   /**
    * perhaps we need to adjust the maximal highlighed line
+   * if we fall back in front of the old highlighted area, the lines in between become checkpoints
    */
-  int oldHighlighted = m_lineHighlighted;
-  if (ctxChanged || current_line > m_lineHighlighted)
+  if (ctxChanged || current_line > m_lineHighlighted) {
+    if (current_line < oldHighlighted)
+      m_lineCheckpointsEnd = oldHighlighted;
+
     m_lineHighlighted = current_line;
+  }
 
   // tag the changed lines !
   if (invalidate) {
@@ -514,7 +613,7 @@ void KateBuffer::doHighlight (int startLine, int endLine, bool invalidate)
 #ifdef BUFFER_DEBUGGING
   kDebug (13020) << "HIGHLIGHTED END --- NEED HL, LINESTART: " << startLine << " LINEEND: " << endLine;
   kDebug (13020) << "HL UNTIL LINE: " << m_lineHighlighted;
-  kDebug (13020) << "HL DYN COUNT: " << KateHlManager::self()->countDynamicCtxs() << " MAX: " << m_maxDynamicContexts;
+  kDebug (13020) << "HL DYN COUNT: " << m_highlight->dynamicContextsCount() << " MAX: " << m_maxDynamicContexts;
   kDebug (13020) << "TIME TAKEN: " << t.elapsed();
 #endif
 }
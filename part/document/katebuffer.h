@@ -25,6 +25,7 @@
 #include "katepartprivate_export.h"
 
 #include <QtCore/QObject>
+#include <QtCore/QTimer>
 
 class KateLineInfo;
 class KateDocument;
@@ -152,6 +153,15 @@ class KATEPART_TESTS_EXPORT KateBuffer : public Kate::TextBuffer
      */
     void ensureHighlighted(int line, int lookAhead = 64);
 
+    /**
+     * Progress of the highlighting, all lines in front of the returned one
+     * are highlighted. Behind the lines requested by ensureHighlighted,
+     * the rest of the document is highlighted in the background, in short
+     * time slices while the event loop is idle.
+     * @return first line without valid highlighting
+     */
+    int lineHighlighted () const { return m_lineHighlighted; }
+
     /**
      * Return the total number of lines in the buffer.
      */
@@ -207,6 +217,12 @@ class KATEPART_TESTS_EXPORT KateBuffer : public Kate::TextBuffer
     KTextEditor::Range computeFoldingRangeForStartLine (int startLine);
 
   private:
+    /**
+     * Adjust the highlighting checkpoints after a line got unwrapped.
+     * @param line line which got unwrapped
+     */
+    void fixCheckpointsForUnwrap (int line);
+
     /**
      * Highlight information needs to be updated.
      *
@@ -216,6 +232,13 @@ class KATEPART_TESTS_EXPORT KateBuffer : public Kate::TextBuffer
      */
     void doHighlight (int from, int to, bool invalidate);
 
+  private Q_SLOTS:
+    /**
+     * Highlight the next lines behind the highlighted area for one
+     * time slice, restarts the timer if lines are left.
+     */
+    void highlightInBackground ();
+
   Q_SIGNALS:
     /**
      * Emitted when the highlighting of a certain range has
@@ -253,10 +276,24 @@ class KATEPART_TESTS_EXPORT KateBuffer : public Kate::TextBuffer
      */
     int m_lineHighlighted;
 
+    /**
+     * end of the checkpoint area behind m_lineHighlighted
+     * each line in ]m_lineHighlighted, m_lineCheckpointsEnd[ still holds the result of
+     * highlighting its unchanged text with the stored context stack of the previous line.
+     * if rehighlighting reproduces the stored context stack of a line in front of one of
+     * these, all of them are valid again and need no new highlighting.
+     */
+    int m_lineCheckpointsEnd;
+
     /**
      * number of dynamic contexts causing a full invalidation
      */
     int m_maxDynamicContexts;
+
+    /**
+     * timer to continue the highlighting in the background
+     */
+    QTimer m_highlightTimer;
 };
 
 #endif
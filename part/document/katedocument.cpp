@@ -451,7 +451,8 @@ QString KateDocument::line( int line ) const
   if (!l)
     return QString();
 
-  return l->string();
+  // a copy anyway, don't inflate compact stored lines for good
+  return l->textCopy();
 }
 
 bool KateDocument::setText(const QString &s)
@@ -23,6 +23,7 @@
 #include "katelayoutcache.moc"
 
 #include <QtAlgorithms>
+#include <QtCore/QTime>
 
 #include "katerenderer.h"
 #include "kateview.h"
@@ -31,6 +32,12 @@
 
 static bool enableLayoutCache = false;
 
+/**
+ * time in ms the layouts around the view may be precomputed at once,
+ * before control goes back to the event loop
+ */
+static const int KATE_LAYOUT_PRECOMPUTE_TIME_SLICE = 5;
+
 //BEGIN KateLineLayoutMap
 KateLineLayoutMap::KateLineLayoutMap()
 {
@@ -154,6 +161,10 @@ KateLayoutCache::KateLayoutCache(KateRenderer* renderer, QObject* parent)
   connect(&m_renderer->doc()->buffer(), SIGNAL(lineUnwrapped(int)), this, SLOT(unwrapLine(int)));
   connect(&m_renderer->doc()->buffer(), SIGNAL(textInserted(KTextEditor::Cursor,QString)), this, SLOT(insertText(KTextEditor::Cursor,QString)));
   connect(&m_renderer->doc()->buffer(), SIGNAL(textRemoved(KTextEditor::Range,QString)), this, SLOT(removeText(KTextEditor::Range)));
+
+  m_precomputeTimer.setSingleShot (true);
+  m_precomputeTimer.setInterval (0);
+  connect (&m_precomputeTimer, SIGNAL(timeout()), this, SLOT(precomputeLayouts()));
 }
 
 void KateLayoutCache::updateViewCache(const KTextEditor::Cursor& startPos, int newViewLineCount, int viewLinesScrolled)
@@ -275,6 +286,52 @@ void KateLayoutCache::updateViewCache(const KTextEditor::Cursor& startPos, int n
   }
 
   enableLayoutCache = false;
+
+  // lay out the surrounding pages later
+  if (!m_precomputeTimer.isActive())
+    m_precomputeTimer.start();
+}
+
+void KateLayoutCache::precomputeLayouts()
+{
+  // nothing to do without a view cache, or while dirty layouts are accepted, they are redone anyway
+  if (m_textLayouts.isEmpty() || !m_textLayouts.first().isValid() || acceptDirtyLayouts())
+    return;
+
+  int lastVirtualLine = m_textLayouts.first().virtualLine();
+  foreach (const KateTextLayout& t, m_textLayouts)
+    if (t.isValid())
+      lastVirtualLine = t.virtualLine();
+
+  const int firstVirtualLine = m_textLayouts.first().virtualLine();
+  const int pageLines = m_textLayouts.count();
+  const int visibleLines = m_renderer->folding().visibleLines();
+
+  enableLayoutCache = true;
+
+  // alternate between the lines below and above the view
+  QTime t;
+  t.start();
+  for (int i = 1; i <= pageLines; ++i) {
+    const int candidates[2] = { lastVirtualLine + i, firstVirtualLine - i };
+    for (int c = 0; c < 2; ++c) {
+      const int virtualLine = candidates[c];
+      if (virtualLine < 0 || virtualLine >= visibleLines)
+        continue;
+
+      const int realLine = m_renderer->folding().visibleLineToLine(virtualLine);
+      if (!m_lineLayouts.contains(realLine) || !m_lineLayouts[realLine]->isValid() || m_lineLayouts[realLine]->isLayoutDirty())
+        line(realLine, virtualLine);
+    }
+
+    // out of time, continue next time the event loop is idle
+    if (t.elapsed() >= KATE_LAYOUT_PRECOMPUTE_TIME_SLICE) {
+      m_precomputeTimer.start();
+      break;
+    }
+  }
+
+  enableLayoutCache = false;
 }
 
 KateLineLayoutPtr KateLayoutCache::line( int realLine, int virtualLine )
@@ -392,13 +449,7 @@ int KateLayoutCache::viewLine(const KTextEditor::Cursor& realCursor)
 
   KateLineLayoutPtr thisLine = line(realCursor.line());
 
-  for (int i = 0; i < thisLine->viewLineCount(); ++i) {
-    const KateTextLayout& l = thisLine->viewLine(i);
-    if (realCursor.column() >= l.startCol() && realCursor.column() < l.endCol())
-      return i;
-  }
-
-  return thisLine->viewLineCount() - 1;
+  return thisLine->viewLineForColumn(realCursor.column());
 }
 
 int KateLayoutCache::displayViewLine(const KTextEditor::Cursor& virtualCursor, bool limitToVisible)
@@ -23,6 +23,7 @@
 #define KATELAYOUTCACHE_H
 
 #include <QPair>
+#include <QTimer>
 
 #include <ktexteditor/range.h>
 
@@ -142,6 +143,12 @@ class KateLayoutCache : public QObject
     // END
 
 private Q_SLOTS:
+    /**
+     * Lay out the lines of the previous and next page while the event
+     * loop is idle, in small time slices, so scrolling finds them ready.
+     */
+    void precomputeLayouts ();
+
     void wrapLine (const KTextEditor::Cursor &position);
     void unwrapLine (int line);
     void insertText (const KTextEditor::Cursor &position, const QString &text);
@@ -165,6 +172,11 @@ private:
     int m_viewWidth;
     bool m_wrap;
     bool m_acceptDirtyLayouts;
+
+    /**
+     * Triggers precomputeLayouts() once the view cache changed.
+     */
+    QTimer m_precomputeTimer;
 };
 
 #endif
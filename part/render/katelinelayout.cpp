@@ -34,6 +34,7 @@ KateLineLayout::KateLineLayout(KateRenderer &renderer)
   , m_line(-1)
   , m_virtualLine(-1)
   , m_shiftX(0)
+  , m_layoutWidth(-1)
   , m_layout(0L)
   , m_layoutDirty(true)
   , m_usePlainTextLine(false)
@@ -112,6 +113,16 @@ void KateLineLayout::setShiftX(int shiftX)
   m_shiftX = shiftX;
 }
 
+int KateLineLayout::layoutWidth() const
+{
+  return m_layoutWidth;
+}
+
+void KateLineLayout::setLayoutWidth(int layoutWidth)
+{
+  m_layoutWidth = layoutWidth;
+}
+
 KateDocument* KateLineLayout::doc() const
 {
   return m_renderer.doc();
@@ -211,14 +222,17 @@ void KateLineLayout::debugOutput() const
 
 int KateLineLayout::viewLineForColumn( int column ) const
 {
-  int len = 0;
-  int i = 0;
-  for (; i < m_layout->lineCount() - 1; ++i) {
-    len += m_layout->lineAt(i).textLength();
-    if (column < len)
-      return i;
+  // view lines are sorted by start column, find the last one starting at or before column
+  int low = 0;
+  int high = m_layout->lineCount() - 1;
+  while (low < high) {
+    const int middle = (low + high + 1) / 2;
+    if (m_layout->lineAt(middle).textStart() <= column)
+      low = middle;
+    else
+      high = middle - 1;
   }
-  return i;
+  return low;
 }
 
 bool KateLineLayout::isLayoutDirty( ) const
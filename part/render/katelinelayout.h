@@ -88,6 +88,10 @@ class KateLineLayout : public KShared
     int shiftX() const;
     void setShiftX(int shiftX);
 
+    // maximal width the current layout was created with, -1 for no wrapping
+    int layoutWidth() const;
+    void setLayoutWidth(int layoutWidth);
+
     QTextLayout* layout() const;
     void setLayout(QTextLayout* layout);
     void invalidateLayout();
@@ -109,6 +113,7 @@ private:
     int m_line;
     int m_virtualLine;
     int m_shiftX;
+    int m_layoutWidth;
 
     QTextLayout* m_layout;
     QList<bool> m_dirtyList;
@@ -343,6 +343,25 @@ QList<QTextLayout::FormatRange> KateRenderer::decorationsForLine( const Kate::Te
 
   // Don't compute the highlighting if there isn't going to be any highlighting
   QList<Kate::TextRange *> rangesWithAttributes = m_doc->buffer().rangesForLine (line, m_printerFriendly ? 0 : m_view, true);
+
+  // only the highlighting of the line itself: its attributes are sorted and don't overlap, convert them directly
+  if (!selectionsOnly && !completionHighlight && rangesWithAttributes.isEmpty() && (!m_view || !m_view->blockSelection())) {
+    const QVector<Kate::TextLineData::Attribute> &al = textLine->attributesList();
+    for (int i = 0; i < al.count(); ++i) {
+      if (al[i].length > 0 && al[i].attributeValue > 0) {
+        if (KTextEditor::Attribute::Ptr a = specificAttribute(al[i].attributeValue)) {
+          QTextLayout::FormatRange fr;
+          fr.start = al[i].offset;
+          fr.length = al[i].length;
+          fr.format = *a;
+          newHighlight.append(fr);
+        }
+      }
+    }
+
+    return newHighlight;
+  }
+
   if (selectionsOnly || textLine->attributesList().count() || rangesWithAttributes.count()) {
     RenderRangeList renderRanges;
 
@@ -912,20 +931,12 @@ qreal KateRenderer::spaceWidth() const
 void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool cacheLayout) const
 {
   // if maxwidth == -1 we have no wrap
+  // remember the requested width, maxwidth is reduced by the indent shift below
+  const int layoutWidth = maxwidth;
 
   Kate::TextLine textLine = lineLayout->textLine();
   Q_ASSERT(textLine);
 
-  QTextLayout* l = lineLayout->layout();
-  if (!l) {
-    l = new QTextLayout(textLine->string(), config()->font());
-  } else {
-    l->setText(textLine->string());
-    l->setFont(config()->font());
-  }
-
-  l->setCacheEnabled(cacheLayout);
-
   // Initial setup of the QTextLayout.
 
   // Tab width
@@ -950,10 +961,34 @@ void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool c
       opt.setTextDirection( Qt::LeftToRight );
   }
 
-  l->setTextOption(opt);
-
   // Syntax highlighting, inbuilt and arbitrary
-  l->setAdditionalFormats(decorationsForLine(textLine, lineLayout->line()));
+  const QList<QTextLayout::FormatRange> decorations = decorationsForLine(textLine, lineLayout->line());
+
+  QTextLayout* l = lineLayout->layout();
+
+  // lines are often retagged without any visible change, e.g. for a selection change
+  // elsewhere: keep the existing layout then, shaping the text is the expensive part
+  if (l && lineLayout->layoutWidth() == layoutWidth
+      && l->text() == textLine->string()
+      && l->font() == config()->font()
+      && l->textOption().tabStop() == opt.tabStop()
+      && l->textOption().textDirection() == opt.textDirection()
+      && sameFormatRanges(l->additionalFormats(), decorations)) {
+    l->setCacheEnabled(cacheLayout);
+    lineLayout->setLayout(l);
+    return;
+  }
+
+  if (!l) {
+    l = new QTextLayout(textLine->string(), config()->font());
+  } else {
+    l->setText(textLine->string());
+    l->setFont(config()->font());
+  }
+
+  l->setCacheEnabled(cacheLayout);
+  l->setTextOption(opt);
+  l->setAdditionalFormats(decorations);
 
   // Begin layouting
   l->beginLayout();
@@ -998,9 +1033,22 @@ void KateRenderer::layoutLine(KateLineLayoutPtr lineLayout, int maxwidth, bool c
 
   l->endLayout();
 
+  lineLayout->setLayoutWidth(layoutWidth);
   lineLayout->setLayout(l);
 }
 
+bool KateRenderer::sameFormatRanges(const QList<QTextLayout::FormatRange>& a, const QList<QTextLayout::FormatRange>& b)
+{
+  if (a.size() != b.size())
+    return false;
+
+  for (int i = 0; i < a.size(); ++i)
+    if (a[i].start != b[i].start || a[i].length != b[i].length || a[i].format != b[i].format)
+      return false;
+
+  return true;
+}
+
 
 // 1) QString::isRightToLeft() sux
 // 2) QString::isRightToLeft() is marked as internal (WTF?)
@@ -332,6 +332,9 @@ public:
 
     void assignSelectionBrushesFromAttribute(QTextLayout::FormatRange& target, const KTextEditor::Attribute& attribute) const;
 
+    /** Compare two lists of format ranges, QTextLayout::FormatRange has no operator==. */
+    static bool sameFormatRanges(const QList<QTextLayout::FormatRange>& a, const QList<QTextLayout::FormatRange>& b);
+
     // update font height
     void updateFontHeight ();
     
@@ -68,6 +68,17 @@
 namespace {
 const QString stdDeliminator = QString (" \t.():!+,-<=>%&*/;?[]^{|}~\\");
 
+// bitmap of stdDeliminator, one bit per UTF-16 code unit, for the checks in doHighlight
+QBitArray createStdDeliminatorBitmap ()
+{
+  QBitArray bitmap (0x10000);
+  foreach (const QChar &c, stdDeliminator)
+    bitmap.setBit (c.unicode());
+  return bitmap;
+}
+
+const QBitArray stdDeliminatorBitmap = createStdDeliminatorBitmap ();
+
 QColor toColor(const QString& configEntry)
 {
   // note: color is stored in hex format in the config files, i.e.: ffafafae
@@ -110,6 +121,8 @@ KateHighlighting::KateHighlighting(const KateSyntaxModeListItem *def) : refCount
   }
 
    deliminator = stdDeliminator;
+
+  lastDynamicCtxsReset.start();
 }
 
 KateHighlighting::~KateHighlighting()
@@ -124,7 +137,7 @@ void KateHighlighting::makeNoneContext()
 {
   iHidden = false;
   m_additionalData.insert( "none", new HighlightPropertyBag );
-  m_additionalData["none"]->deliminator = stdDeliminator;
+  m_additionalData["none"]->setDeliminator (stdDeliminator);
   m_additionalData["none"]->wordWrapDeliminator = stdDeliminator;
   m_hlIndex[0] = "none";
   m_ctxIndex[0]= "none";
@@ -140,9 +153,24 @@ void KateHighlighting::cleanup ()
 
   m_attributeArrays.clear ();
 
+  m_sharedContextStacks.clear ();
+
   internalIDList.clear();
 }
 
+const Kate::TextLineData::ContextStack &KateHighlighting::sharedContextStack (const Kate::TextLineData::ContextStack &contextStack)
+{
+  QSet<Kate::TextLineData::ContextStack>::const_iterator it = m_sharedContextStacks.constFind (contextStack);
+  if (it != m_sharedContextStacks.constEnd ())
+    return *it;
+
+  // pathological files with lots of distinct stacks: start over, lines just keep their copies
+  if (m_sharedContextStacks.size () >= KATE_MAX_SHARED_CONTEXT_STACKS)
+    m_sharedContextStacks.clear ();
+
+  return *m_sharedContextStacks.insert (contextStack);
+}
+
 KateHlContext *KateHighlighting::generateContextStack (Kate::TextLineData::ContextStack &contextStack,
                                                        KateHlContextModification modification,
                                                        int &indexLastContextPreviousLine)
@@ -240,7 +268,6 @@ int KateHighlighting::makeDynamicContext(KateHlContext *model, const QStringList
 
     value = startctx++;
     dynamicCtxs[key] = value;
-    KateHlManager::self()->incDynamicCtxs();
   }
 
   // kDebug(13010) << "Dynamic context: using context #" << value << " (for model " << model << " with args " << *args << ")";
@@ -265,6 +292,20 @@ void KateHighlighting::dropDynamicContexts()
 
   dynamicCtxs.clear();
   startctx = base_startctx;
+
+  // the stacks may reference the dropped contexts
+  m_sharedContextStacks.clear ();
+}
+
+bool KateHighlighting::resetDynamicContexts()
+{
+  if (lastDynamicCtxsReset.elapsed() < KATE_DYNAMIC_CONTEXTS_RESET_DELAY)
+    return false;
+
+  dropDynamicContexts();
+  lastDynamicCtxsReset.start();
+
+  return true;
 }
 
 void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
@@ -288,8 +329,8 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
     return;
 
   const bool firstLine = (_prevLine == 0);
-  const Kate::TextLine dummy = Kate::TextLine (new Kate::TextLineData ());
-  const Kate::TextLineData * prevLine = firstLine ? dummy.data() : _prevLine;
+  static const Kate::TextLineData emptyLine;
+  const Kate::TextLineData * prevLine = firstLine ? &emptyLine : _prevLine;
 
   int previousLine = -1;
   KateHlContext *context;
@@ -330,8 +371,12 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
 
   // text, for programming convenience :)
   QChar lastChar = ' ';
-  const QString& text = textLine->string();
-  const int len = textLine->length();
+  // a copy, string() would inflate compact stored lines for good
+  const QString text = textLine->textCopy();
+  const int lineLength = textLine->length();
+
+  // very long lines (e.g. minified files) are only highlighted up to a fixed column, see below
+  const int len = qMin (lineLength, KATE_HL_MAX_LINE_LENGTH);
 
   // calc at which char the first char occurs, set it to length of line if never
   const int firstChar = textLine->firstChar();
@@ -347,7 +392,8 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
   KateHlContext* oldContext = context;
 
   // optimization: list of highlighting items that need their cache reset
-  static QVarLengthArray<KateHlItem*> cachingItems;
+  // kept local to this call, doHighlight must not depend on state of an other pass
+  QVarLengthArray<KateHlItem*, 32> cachingItems;
 
   // catch empty lines
   if (len == 0) {
@@ -378,7 +424,8 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
       bool anItemMatched = false;
       bool customStartEnableDetermined = false;
 
-      foreach (item, context->items)
+      // only try the items which can match at the current character
+      foreach (item, context->itemsForChar (text[offset]))
       {
         // does we only match if we are firstNonSpace?
         if (item->firstNonSpace && (offset > startNonSpace))
@@ -396,7 +443,7 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
                 oldContext = context;
                 additionalData = m_additionalData[oldContext->hlId];
               }
-              if (customStartEnableDetermined || additionalData->deliminator.contains(lastChar))
+              if (customStartEnableDetermined || additionalData->isDeliminator(lastChar))
                 customStartEnableDetermined = true;
               else
                 continue;
@@ -404,7 +451,7 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
           else
           {
             if (lastDelimChar == lastChar) {
-            } else if ( stdDeliminator.contains(lastChar) ) {
+            } else if ( stdDeliminatorBitmap.testBit(lastChar.unicode()) ) {
               lastDelimChar = lastChar;
             } else {
               continue;
@@ -534,6 +581,13 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
         offset++;
       }
     }
+
+    /**
+     * the rest of a very long line just gets the attribute of the context active there,
+     * trying all rules at each of maybe millions of columns would block for seconds
+     */
+    if (len < lineLength && context->attr > 0)
+      textLine->addAttribute (Kate::TextLineData::Attribute (len, lineLength - len, context->attr, 0));
     
     /**
      * check if folding is not balanced and we have more starts then ends
@@ -543,7 +597,7 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
       /**
        * possible folding start, if imbalanced, aka hash not empty!
        */
-      if (!foldingStartToCount->isEmpty())
+      if (!foldingStartToCount->isEmpty() && len == lineLength)
         textLine->markAsFoldingStartAttribute ();
       
       /**
@@ -552,6 +606,15 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
       delete foldingStartToCount;
       foldingStartToCount = 0;
     }
+
+    /**
+     * a very long line is only highlighted up to the limit, the state there is no valid
+     * end state, e.g. a comment opened before the limit may be closed behind it:
+     * let the next line continue as if this line didn't exist (the folding start mark
+     * above is skipped for the same reason)
+     */
+    if (len < lineLength)
+      ctx = prevLine->contextStack();
   }
   
   /**
@@ -559,27 +622,17 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
    */
   if ((ctxChanged = (ctx != textLine->contextStack()))) {
     /**
-     * try to share the simple stack that contains only 0
+     * try to share data with last line, else with any line with the same stack
      */
-    static const Kate::TextLineData::ContextStack onlyDefaulContext (1, 0);
-    if (ctx == onlyDefaulContext)
-      textLine->setContextStack(onlyDefaulContext);
-    
-    /**
-     * next try: try to share data with last line
-     */
-    else if (ctx == prevLine->contextStack())
+    if (ctx == prevLine->contextStack())
       textLine->setContextStack(prevLine->contextStack());
-    
-    /**
-     * ok, really use newly constructed stack!
-     */
     else
-      textLine->setContextStack(ctx);
+      textLine->setContextStack(sharedContextStack (ctx));
   }
 
-  // write hl continue flag
-  textLine->setHlLineContinue (item && item->lineContinue());
+  // write hl continue flag, only if the line was highlighted to its very end,
+  // a continuation char at the highlighting limit of a long line doesn't count
+  textLine->setHlLineContinue (len == lineLength && item && item->lineContinue());
 
   // check for indentation based folding
   if (m_foldingIndentationSensitive && (tabWidth > 0) && !textLine->markedAsFoldingStartAttribute ()) {
@@ -599,12 +652,11 @@ void KateHighlighting::doHighlight ( const Kate::TextLineData *_prevLine,
        textLine->markAsFoldingStartIndentation ();
   }
   
-  // invalidate caches
+  // invalidate caches, they are only valid for the text of this line
   for ( int i = 0; i < cachingItems.size(); ++i) {
     cachingItems[i]->cachingHandled = false;
     cachingItems[i]->haveCache = false;
   }
-  cachingItems.clear();
 }
 
 void KateHighlighting::getKateExtendedAttributeList (const QString &schema, QList<KateExtendedAttribute::Ptr> &list, KConfig* cfg)
@@ -1033,7 +1085,16 @@ KateHlItem *KateHighlighting::createKateHlItem(KateSyntaxContextData *data,
   else if (dataname=="StringDetect") tmpItem=(new KateHlStringDetect(attr,context,regionId,regionId2,stringdata,insensitive));
   else if (dataname=="WordDetect") tmpItem=(new KateHlWordDetect(attr,context,regionId,regionId2,stringdata,insensitive));
   else if (dataname=="AnyChar") tmpItem=(new KateHlAnyChar(attr,context,regionId,regionId2,stringdata));
-  else if (dataname=="RegExpr") tmpItem=(new KateHlRegExpr(attr,context,regionId,regionId2,stringdata, insensitive, minimal));
+  else if (dataname=="RegExpr")
+  {
+    KateHlRegExpr *regexp = new KateHlRegExpr(attr,context,regionId,regionId2,stringdata, insensitive, minimal);
+
+    // dynamic rules are only complete after the substitution
+    if (!dynamic && !regexp->isValid())
+      kWarning(13010) << buildIdentifier << ": invalid regular expression" << stringdata;
+
+    tmpItem=regexp;
+  }
   else if (dataname=="HlCChar") tmpItem= ( new KateHlCChar(attr,context,regionId,regionId2));
   else if (dataname=="HlCHex") tmpItem= (new KateHlCHex(attr,context,regionId,regionId2));
   else if (dataname=="HlCOct") tmpItem= (new KateHlCOct(attr,context,regionId,regionId2));
@@ -1111,7 +1172,7 @@ QString KateHighlighting::hlKeyForAttrib( int i ) const
 
 bool KateHighlighting::isInWord( QChar c, int attrib ) const
 {
-  return m_additionalData[ hlKeyForAttrib( attrib ) ]->deliminator.indexOf(c) < 0
+  return !m_additionalData[ hlKeyForAttrib( attrib ) ]->isDeliminator(c)
       && !c.isSpace()
       && c != QChar::fromAscii('"') && c != QChar::fromAscii('\'') && c != QChar::fromAscii('`');
 }
@@ -1305,7 +1366,7 @@ void KateHighlighting::readGlobalKeywordConfig()
   kDebug(13010)<<"delimiterCharacters are: "<<deliminator;
 #endif
 
-  m_additionalData[buildIdentifier]->deliminator = deliminator;
+  m_additionalData[buildIdentifier]->setDeliminator (deliminator);
 }
 
 /**
@@ -2198,13 +2259,13 @@ QStringList KateHighlighting::getEmbeddedHighlightingModes() const
 
 bool KateHighlighting::isEmptyLine(const Kate::TextLineData *textline) const
 {
-  const QString &txt=textline->string();
-  if (txt.isEmpty())
+  if (textline->length() == 0)
     return true;
   
   QLinkedList<QRegExp> l;
   l=emptyLines(textline->attribute(0));
   if (l.isEmpty()) return false;
+  const QString txt=textline->textCopy();
   foreach(const QRegExp &re,l) {
     if (re.exactMatch(txt)) return true;
   }
@@ -30,8 +30,10 @@
 #include <kactionmenu.h>
 
 #include <QtCore/QVector>
+#include <QtCore/QBitArray>
 #include <QtCore/QList>
 #include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QtCore/QMap>
 
 #include <QtCore/QRegExp>
@@ -54,6 +56,12 @@ class KateSyntaxContextData;
 // min. x seconds between two dynamic contexts reset
 #define KATE_DYNAMIC_CONTEXTS_RESET_DELAY (30 * 1000)
 
+// max. number of distinct context stacks shared between the lines
+#define KATE_MAX_SHARED_CONTEXT_STACKS 4096
+
+// lines are only highlighted up to this column, the rest gets the attribute of the context there
+#define KATE_HL_MAX_LINE_LENGTH (16 * 1024)
+
 
 /**
  * describe a modification of the context stack
@@ -116,6 +124,17 @@ typedef QList<KateHlIncludeRule*> KateHlIncludeRules;
 typedef QMap<QString,KateEmbeddedHlInfo> KateEmbeddedHlInfos;
 typedef QMap<KateHlContextModification*,QString> KateHlUnresolvedCtxRefs;
 
+/**
+ * hash for context stacks, needed to share equal ones between lines
+ */
+inline uint qHash (const Kate::TextLineData::ContextStack &stack)
+{
+  uint h = stack.size ();
+  for (int i = 0; i < stack.size (); ++i)
+    h = 31 * h + ushort (stack[i]);
+  return h;
+}
+
 class KateHighlighting
 {
   public:
@@ -257,6 +276,19 @@ class KateHighlighting
     // be carefull: all documents hl should be invalidated after calling this method!
     void dropDynamicContexts();
 
+    /**
+     * Number of dynamic contexts created since they got dropped the last time.
+     */
+    int dynamicContextsCount () const { return dynamicCtxs.size(); }
+
+    /**
+     * Drop the dynamic contexts, if the last reset is at least
+     * KATE_DYNAMIC_CONTEXTS_RESET_DELAY ago.
+     * be carefull: all documents using this hl should be invalidated if this returns true!
+     * @return dynamic contexts dropped?
+     */
+    bool resetDynamicContexts ();
+
     QString indentation () { return m_indentation; }
 
     void getKateExtendedAttributeList(const QString &schema, QList<KateExtendedAttribute::Ptr> &, KConfig* cfg=0);
@@ -307,6 +339,14 @@ class KateHighlighting
      */
     KateHlContext *generateContextStack(Kate::TextLineData::ContextStack &contextStack, KateHlContextModification modification, int &indexLastContextPreviousLine);
 
+    /**
+     * get the shared copy of the given context stack, equal stacks of all lines
+     * then share their data and compare by the data pointer first
+     * @param contextStack context stack to share
+     * @return shared stack equal to @p contextStack
+     */
+    const Kate::TextLineData::ContextStack &sharedContextStack (const Kate::TextLineData::ContextStack &contextStack);
+
     KateHlItem *createKateHlItem(KateSyntaxContextData *data, QList<KateExtendedAttribute::Ptr> &iDl, QStringList *RegionList, QStringList *ContextList);
     int lookupAttrName(const QString& name, QList<KateExtendedAttribute::Ptr> &iDl);
 
@@ -319,6 +359,12 @@ class KateHighlighting
 
     QMap< QPair<KateHlContext *, QString>, short> dynamicCtxs;
 
+    // time of the last reset of the dynamic contexts
+    QTime lastDynamicCtxsReset;
+
+    // distinct context stacks of the highlighted lines, see sharedContextStack
+    QSet<Kate::TextLineData::ContextStack> m_sharedContextStacks;
+
     // make them pointers perhaps
     // NOTE: gets cleaned once makeContextList() finishes
     KateEmbeddedHlInfos embeddedHls;
@@ -376,12 +422,31 @@ class KateHighlighting
      */
     class HighlightPropertyBag {
       public:
+        HighlightPropertyBag () : deliminatorBitmap (0x10000) {}
+
+        /**
+         * Set the deliminators, keeps the bitmap for fast lookups in sync.
+         */
+        void setDeliminator (const QString &delims)
+        {
+          deliminator = delims;
+          deliminatorBitmap.fill (false);
+          foreach (const QChar &c, delims)
+            deliminatorBitmap.setBit (c.unicode());
+        }
+
+        /**
+         * @return true if @p c is one of the deliminators
+         */
+        inline bool isDeliminator (QChar c) const { return deliminatorBitmap.testBit (c.unicode()); }
+
         QString singleLineCommentMarker;
         QString multiLineCommentStart;
         QString multiLineCommentEnd;
         QString multiLineRegion;
         CSLPos  singleLineCommentPosition;
         QString deliminator;
+        QBitArray deliminatorBitmap;
         QString wordWrapDeliminator;
         QLinkedList<QRegExp> emptyLines;
         QHash<QString, QChar> characterEncodings;
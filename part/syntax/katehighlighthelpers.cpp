@@ -33,6 +33,7 @@
 #include "kateextendedattribute.h"
 
 #include <QtCore/QSet>
+#include <QtCore/QVarLengthArray>
 //END
 
 //BEGIN KateHlItem
@@ -100,6 +101,11 @@ int KateHlCharDetect::checkHgl(const QString& text, int offset, int /*len*/)
   return 0;
 }
 
+bool KateHlCharDetect::canStartWith(QChar c) const
+{
+  return c == sChar;
+}
+
 KateHlItem *KateHlCharDetect::clone(const QStringList *args)
 {
   char c = sChar.toLatin1();
@@ -129,6 +135,11 @@ int KateHl2CharDetect::checkHgl(const QString& text, int offset, int len)
   return 0;
 }
 
+bool KateHl2CharDetect::canStartWith(QChar c) const
+{
+  return c == sChar1;
+}
+
 KateHlItem *KateHl2CharDetect::clone(const QStringList *args)
 {
   char c1 = sChar1.toLatin1();
@@ -180,6 +191,14 @@ int KateHlStringDetect::checkHgl(const QString& text, int offset, int len)
   return 0;
 }
 
+bool KateHlStringDetect::canStartWith(QChar c) const
+{
+  if (strLen == 0)
+    return true;
+
+  return (_inSensitive ? c.toUpper() : c) == str[0];
+}
+
 KateHlItem *KateHlStringDetect::clone(const QStringList *args)
 {
   QString newstr = str;
@@ -267,19 +286,25 @@ int KateHlRangeDetect::checkHgl(const QString& text, int offset, int len)
   }
   return 0;
 }
+
+bool KateHlRangeDetect::canStartWith(QChar c) const
+{
+  return c == sChar1;
+}
 //END
 
 //BEGIN KateHlKeyword
 KateHlKeyword::KateHlKeyword (int attribute, KateHlContextModification context, signed char regionId,signed char regionId2, bool insensitive, const QString& delims)
   : KateHlItem(attribute,context,regionId,regionId2)
   , _insensitive(insensitive)
+  , deliminators (0x10000)
   , minLen (0xFFFFFF)
   , maxLen (0)
 {
   alwaysStartEnable = false;
   customStartEnable = true;
   foreach (const QChar &c, delims)
-    deliminators << c;
+    deliminators.setBit (c.unicode());
 }
 
 KateHlKeyword::~KateHlKeyword ()
@@ -332,10 +357,11 @@ void KateHlKeyword::addList(const QStringList& list)
 
 int KateHlKeyword::checkHgl(const QString& text, int offset, int len)
 {
+  const QChar *chars = text.unicode();
   int offset2 = offset;
   int wordLen = 0;
 
-  while ((len > wordLen) && !deliminators.contains(text[offset2]))
+  while ((len > wordLen) && !deliminators.testBit(chars[offset2].unicode()))
   {
     offset2++;
     wordLen++;
@@ -347,17 +373,39 @@ int KateHlKeyword::checkHgl(const QString& text, int offset, int len)
 
   if (!_insensitive)
   {
-    if (dict[wordLen]->contains(QString::fromRawData(text.unicode() + offset, wordLen)) )
+    if (dict[wordLen]->contains(QString::fromRawData(chars + offset, wordLen)) )
       return offset2;
+
+    return 0;
   }
-  else
+
+  // lower the word on the stack, no temporary string needed
+  // QChar::toLower equals QString::toLower only for Latin-1, take the slow path for anything else
+  QVarLengthArray<QChar, 64> lowered (wordLen);
+  for (int i = 0; i < wordLen; ++i)
   {
-    if (dict[wordLen]->contains(QString::fromRawData(text.unicode() + offset, wordLen).toLower()) )
-      return offset2;
+    const QChar c = chars[offset + i];
+    if (c.unicode() > 0xff)
+    {
+      if (dict[wordLen]->contains(QString::fromRawData(chars + offset, wordLen).toLower()) )
+        return offset2;
+
+      return 0;
+    }
+
+    lowered[i] = c.toLower();
   }
 
+  if (dict[wordLen]->contains(QString::fromRawData(lowered.constData(), wordLen)) )
+    return offset2;
+
   return 0;
 }
+
+bool KateHlKeyword::canStartWith(QChar c) const
+{
+  return !deliminators.testBit(c.unicode());
+}
 //END
 
 //BEGIN KateHlInt
@@ -393,6 +441,11 @@ int KateHlInt::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool KateHlInt::canStartWith(QChar c) const
+{
+  return c.isDigit();
+}
 //END
 
 //BEGIN KateHlFloat
@@ -489,6 +542,11 @@ int KateHlFloat::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool KateHlFloat::canStartWith(QChar c) const
+{
+  return c.isDigit() || c == '.';
+}
 //END
 
 //BEGIN KateHlCOct
@@ -524,6 +582,11 @@ int KateHlCOct::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool KateHlCOct::canStartWith(QChar c) const
+{
+  return c.toAscii() == '0';
+}
 //END
 
 //BEGIN KateHlCHex
@@ -558,6 +621,11 @@ int KateHlCHex::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool KateHlCHex::canStartWith(QChar c) const
+{
+  return c.toAscii() == '0';
+}
 //END
 
 //BEGIN KateHlCFloat
@@ -619,20 +687,66 @@ int KateHlAnyChar::checkHgl(const QString& text, int offset, int)
 
   return 0;
 }
+
+bool KateHlAnyChar::canStartWith(QChar c) const
+{
+  return _charList.contains(c);
+}
 //END
 
 //BEGIN KateHlRegExpr
+/**
+ * The character each match of @p regexp must start with, or a null QChar
+ * if that is not known. Only simple literal prefixes are detected.
+ */
+static QChar firstLiteral(const QString &regexp)
+{
+  // alternatives may start with anything
+  if (regexp.contains('|'))
+    return QChar();
+
+  int i = regexp.startsWith('^') ? 1 : 0;
+  if (i >= regexp.length())
+    return QChar();
+
+  QChar c = regexp[i++];
+  if (c == '\\')
+  {
+    // only escaped punctuation is a literal, \d, \w, \x20 and friends are not
+    if (i >= regexp.length() || regexp[i].isLetterOrNumber())
+      return QChar();
+
+    c = regexp[i++];
+  }
+  else if (QString("^$.?*+()[]{}").contains(c))
+    return QChar();
+
+  // the literal must not be optional
+  if (i < regexp.length() && (regexp[i] == '?' || regexp[i] == '*' || regexp[i] == '{'))
+    return QChar();
+
+  return c;
+}
+
 KateHlRegExpr::KateHlRegExpr( int attribute, KateHlContextModification context, signed char regionId,signed char regionId2, const QString &regexp, bool insensitive, bool minimal)
   : KateHlItem(attribute, context, regionId,regionId2)
   , handlesLinestart (regexp.startsWith('^'))
   , _regexp(regexp)
   , _insensitive(insensitive)
   , _minimal(minimal)
+  , _firstChar(firstLiteral(regexp))
   , _lastOffset(-2) // -2 is start value, -1 is "not found at all"
   , Expr (regexp, _insensitive ? Qt::CaseInsensitive : Qt::CaseSensitive)
 {
   // minimal or not ;)
   Expr.setMinimal(_minimal);
+
+  // compile the expression now and not while highlighting the first line
+  _valid = Expr.isValid();
+
+  // case insensitive letters may start with other characters
+  if (_insensitive && _firstChar.isLetter())
+    _firstChar = QChar();
 }
 
 int KateHlRegExpr::checkHgl(const QString& text, int offset, int /*len*/)
@@ -640,6 +754,10 @@ int KateHlRegExpr::checkHgl(const QString& text, int offset, int /*len*/)
   if (offset && handlesLinestart)
     return 0;
 
+  // no need to run the expression if the first character can't match
+  if (!_firstChar.isNull() && text[offset] != _firstChar)
+    return 0;
+
   // optimization: if we check something on the same text as the last time,
   //               try to reuse what we got that time
   if ( haveCache ) {
@@ -667,6 +785,14 @@ int KateHlRegExpr::checkHgl(const QString& text, int offset, int /*len*/)
   }
 }
 
+bool KateHlRegExpr::canStartWith(QChar c) const
+{
+  if (!_valid)
+    return false;
+
+  return _firstChar.isNull() || c == _firstChar;
+}
+
 void KateHlRegExpr::capturedTexts (QStringList &list)
 {
   list = Expr.capturedTexts();
@@ -709,6 +835,11 @@ int KateHlLineContinue::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool KateHlLineContinue::canStartWith(QChar c) const
+{
+  return c == m_trailer;
+}
 //END
 
 //BEGIN KateHlCStringChar
@@ -790,6 +921,11 @@ int KateHlCStringChar::checkHgl(const QString& text, int offset, int len)
 {
   return checkEscapedChar(text, offset, len);
 }
+
+bool KateHlCStringChar::canStartWith(QChar c) const
+{
+  return c == '\\';
+}
 //END
 
 //BEGIN KateHlCChar
@@ -827,6 +963,11 @@ int KateHlCChar::checkHgl(const QString& text, int offset, int len)
 
   return 0;
 }
+
+bool KateHlCChar::canStartWith(QChar c) const
+{
+  return c == '\'';
+}
 //END
 
 //BEGIN KateHl2CharDetect
@@ -874,6 +1015,27 @@ KateHlContext *KateHlContext::clone(const QStringList *args)
   return ret;
 }
 
+void KateHlContext::buildDispatchTable ()
+{
+  itemsForLatin1.resize (256);
+
+  for (int c = 0; c < 256; ++c)
+  {
+    QVector<KateHlItem*> candidates;
+    foreach (KateHlItem *item, items)
+      if (item->canStartWith (QChar (c)))
+        candidates.append (item);
+
+    // share the vectors, most characters get all items or the same ones as their predecessor
+    if (candidates.size() == items.size())
+      itemsForLatin1[c] = items;
+    else if (c > 0 && candidates == itemsForLatin1[c-1])
+      itemsForLatin1[c] = itemsForLatin1[c-1];
+    else
+      itemsForLatin1[c] = candidates;
+  }
+}
+
 KateHlContext::~KateHlContext()
 {
   if (dynamicChild)
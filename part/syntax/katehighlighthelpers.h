@@ -37,6 +37,10 @@ class KateHlItem
     // bool linestart isn't needed, this is equivalent to offset == 0.
     virtual int checkHgl(const QString& text, int offset, int len) = 0;
 
+    // must return true for each character checkHgl might match at, is used to
+    // build the dispatch tables of the contexts, see KateHlContext::itemsForChar
+    virtual bool canStartWith(QChar) const {return true;}
+
     virtual bool lineContinue(){return false;}
 
     virtual void capturedTexts (QStringList &) { }
@@ -64,6 +68,7 @@ class KateHlItem
     bool customStartEnable;
 
     // set to true when you cached something
+    // the cache is only valid for the line currently parsed, doHighlight resets it at the end
     bool haveCache;
     // internal for doHighlight, don't set it in the items
     bool cachingHandled;
@@ -79,6 +84,22 @@ class KateHlContext
     virtual ~KateHlContext();
     KateHlContext *clone(const QStringList *args);
 
+    /**
+     * Items which might match at a position with character @p c, in the order
+     * of items. The table for the Latin-1 characters is built on first use,
+     * all other characters just get all items.
+     */
+    inline const QVector<KateHlItem*> &itemsForChar (QChar c)
+    {
+      if (c.unicode() > 0xff)
+        return items;
+
+      if (itemsForLatin1.isEmpty())
+        buildDispatchTable ();
+
+      return itemsForLatin1[c.unicode()];
+    }
+
     QVector<KateHlItem*> items;
     QString hlId; ///< A unique highlight identifier. Used to look up correct properties.
     int attr;
@@ -97,6 +118,11 @@ class KateHlContext
     
     bool emptyLineContext;
     KateHlContextModification emptyLineContextModification;
+
+  private:
+    void buildDispatchTable ();
+
+    QVector< QVector<KateHlItem*> > itemsForLatin1;
 };
 
 class KateHlIncludeRule
@@ -126,6 +152,7 @@ class KateHlCharDetect : public KateHlItem
     KateHlCharDetect(int attribute, KateHlContextModification context,signed char regionId,signed char regionId2, QChar);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
     virtual KateHlItem *clone(const QStringList *args);
 
   private:
@@ -139,6 +166,7 @@ class KateHl2CharDetect : public KateHlItem
     KateHl2CharDetect(int attribute, KateHlContextModification context,signed char regionId,signed char regionId2,  const QChar *ch);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
     virtual KateHlItem *clone(const QStringList *args);
 
   private:
@@ -152,6 +180,7 @@ class KateHlStringDetect : public KateHlItem
     KateHlStringDetect(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2, const QString &, bool inSensitive=false);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
     virtual KateHlItem *clone(const QStringList *args);
 
   protected:
@@ -175,6 +204,7 @@ class KateHlRangeDetect : public KateHlItem
     KateHlRangeDetect(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2, QChar ch1, QChar ch2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 
   private:
     QChar sChar1;
@@ -189,12 +219,13 @@ class KateHlKeyword : public KateHlItem
 
     void addList(const QStringList &);
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
     QSet<QString> allKeywords() const;
 
   private:
     QVector< QSet<QString>* > dict;
     bool _insensitive;
-    QSet<QChar> deliminators;
+    QBitArray deliminators;
     int minLen;
     int maxLen;
 };
@@ -205,6 +236,7 @@ class KateHlInt : public KateHlItem
     KateHlInt(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 };
 
 class KateHlFloat : public KateHlItem
@@ -214,6 +246,7 @@ class KateHlFloat : public KateHlItem
     virtual ~KateHlFloat () {}
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 };
 
 class KateHlCFloat : public KateHlFloat
@@ -231,6 +264,7 @@ class KateHlCOct : public KateHlItem
     KateHlCOct(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 };
 
 class KateHlCHex : public KateHlItem
@@ -239,6 +273,7 @@ class KateHlCHex : public KateHlItem
     KateHlCHex(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 };
 
 class KateHlLineContinue : public KateHlItem
@@ -248,6 +283,7 @@ class KateHlLineContinue : public KateHlItem
 
     virtual bool endEnable(QChar c) {return c == '\0';}
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
     virtual bool lineContinue(){return true;}
 
   private:
@@ -260,6 +296,7 @@ class KateHlCStringChar : public KateHlItem
     KateHlCStringChar(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 };
 
 class KateHlCChar : public KateHlItem
@@ -268,6 +305,7 @@ class KateHlCChar : public KateHlItem
     KateHlCChar(int attribute, KateHlContextModification context,signed char regionId,signed char regionId2);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 };
 
 class KateHlAnyChar : public KateHlItem
@@ -276,6 +314,7 @@ class KateHlAnyChar : public KateHlItem
     KateHlAnyChar(int attribute, KateHlContextModification context, signed char regionId,signed char regionId2, const QString& charList);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
 
   private:
     const QString _charList;
@@ -287,6 +326,12 @@ class KateHlRegExpr : public KateHlItem
     KateHlRegExpr(int attribute, KateHlContextModification context,signed char regionId,signed char regionId2 ,const QString &expr, bool insensitive, bool minimal);
 
     virtual int checkHgl(const QString& text, int offset, int len);
+    virtual bool canStartWith(QChar c) const;
+
+    /**
+     * @return false if the expression does not compile, it will never match then
+     */
+    bool isValid() const {return _valid;}
     
     virtual void capturedTexts (QStringList &);
     
@@ -299,6 +344,10 @@ class KateHlRegExpr : public KateHlItem
     bool _minimal;
 
     // optimization stuff below
+    /// the expression compiles
+    bool _valid;
+    /// character each match starts with, null if not known
+    QChar _firstChar;
     /// index of the last match
     int _lastOffset;
     /// length of the last match
@@ -319,6 +368,8 @@ class KateHlDetectSpaces : public KateHlItem
       while ((offset < len2) && text[offset].isSpace()) offset++;
       return offset;
     }
+
+    virtual bool canStartWith(QChar c) const {return c.isSpace();}
 };
 
 class KateHlDetectIdentifier : public KateHlItem
@@ -327,6 +378,8 @@ class KateHlDetectIdentifier : public KateHlItem
     KateHlDetectIdentifier (int attribute, KateHlContextModification context,signed char regionId,signed char regionId2)
       : KateHlItem(attribute,context,regionId,regionId2) { alwaysStartEnable = false; }
 
+    virtual bool canStartWith(QChar c) const {return c.isLetter() || c == QChar ('_');}
+
     virtual int checkHgl(const QString& text, int offset, int len)
     {
       // first char should be a letter or underscore
@@ -41,6 +41,7 @@
 KateSyntaxDocument::KateSyntaxDocument(KConfig *config, bool force)
   : QDomDocument()
   , m_config (config)
+  , m_parsedFiles (16)
 {
   // Let's build the Mode List (katesyntaxhighlightingrc)
   setupModeList(force);
@@ -61,6 +62,20 @@ bool KateSyntaxDocument::setIdentifier(const QString& identifier)
   // if the current file is the same as the new one don't do anything.
   if(currentFile != identifier)
   {
+    // stat the file, cached documents are only valid as long as it is unchanged
+    KDE_struct_stat sbuf;
+    memset (&sbuf, 0, sizeof(sbuf));
+    KDE::stat(identifier, &sbuf);
+
+    const ParsedFile *parsed = m_parsedFiles.object(identifier);
+    if (parsed && parsed->lastModified == qint64(sbuf.st_mtime))
+    {
+      // the dom is never modified, just share it
+      QDomDocument::operator= (parsed->document);
+      currentFile = identifier;
+      return true;
+    }
+
     // let's open the new file
     QFile f( identifier );
 
@@ -68,10 +83,13 @@ bool KateSyntaxDocument::setIdentifier(const QString& identifier)
     {
       // Let's parse the contets of the xml file
       /* The result of this function should be check for robustness,
-         a false returned means a parse error */
+         a false returned means a parse error
+         parse into a new document, setContent would clear a cached one we share */
       QString errorMsg;
       int line, col;
-      bool success=setContent(&f,&errorMsg,&line,&col);
+      QDomDocument document;
+      bool success=document.setContent(&f,&errorMsg,&line,&col);
+      QDomDocument::operator= (document);
 
       // Ok, now the current file is the pretended one (identifier)
       currentFile = identifier;
@@ -85,6 +103,11 @@ bool KateSyntaxDocument::setIdentifier(const QString& identifier)
              line, col, i18nc("QXml",errorMsg.toUtf8())));
         return false;
       }
+
+      ParsedFile *newParsed = new ParsedFile;
+      newParsed->document = document;
+      newParsed->lastModified = sbuf.st_mtime;
+      m_parsedFiles.insert(identifier, newParsed);
     }
     else
     {
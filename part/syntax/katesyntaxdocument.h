@@ -20,6 +20,7 @@
 #ifndef __KATE_SYNTAXDOCUMENT_H__
 #define __KATE_SYNTAXDOCUMENT_H__
 
+#include <QtCore/QCache>
 #include <QtCore/QList>
 #include <QtCore/QStringList>
 #include <QtXml/QDomDocument>
@@ -171,6 +172,22 @@ class KateSyntaxDocument : public QDomDocument
      * global config, deleted by hlmanager...
      */
     KConfig *m_config;
+
+    /**
+     * A parsed xml file together with the modification time of the file
+     */
+    class ParsedFile
+    {
+      public:
+        QDomDocument document;
+        qint64 lastModified;
+    };
+
+    /**
+     * parsed xml files, switching between highlightings, e.g. for includes,
+     * or loading one again must not parse the file again
+     */
+    QCache<QString, ParsedFile> m_parsedFiles;
 };
 
 #endif
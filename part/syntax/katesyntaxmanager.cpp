@@ -72,7 +72,6 @@ KateHlManager::KateHlManager()
   , m_config ("katesyntaxhighlightingrc", KConfig::NoGlobals)
   , commonSuffixes (QString(".orig;.new;~;.bak;.BAK").split(';'))
   , syntax (new KateSyntaxDocument(&m_config))
-  , dynamicCtxsCount(0)
   , forceNoDCReset(false)
 {
   KateSyntaxModeList modeList = syntax->modeList();
@@ -90,8 +89,6 @@ KateHlManager::KateHlManager()
   KateHighlighting *hl = new KateHighlighting(0);
   hlList.prepend (hl);
   hlDict.insert (hl->name(), hl);
-
-  lastCtxsReset.start();
 }
 
 KateHlManager::~KateHlManager()
@@ -398,21 +395,13 @@ QString KateHlManager::nameForIdentifier(const QString& identifier)
   return QString();
 }
 
-bool KateHlManager::resetDynamicCtxs()
+bool KateHlManager::resetDynamicCtxs(KateHighlighting *hl)
 {
   if (forceNoDCReset)
     return false;
 
-  if (lastCtxsReset.elapsed() < KATE_DYNAMIC_CONTEXTS_RESET_DELAY)
-    return false;
-
-  foreach (KateHighlighting *hl, hlList)
-    hl->dropDynamicContexts();
-
-  dynamicCtxsCount = 0;
-  lastCtxsReset.start();
-
-  return true;
+  // only the given hl has too many of them, others stay untouched
+  return hl->resetDynamicContexts();
 }
 //END
 
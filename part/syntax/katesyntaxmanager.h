@@ -82,12 +82,10 @@ class KateHlManager : public QObject
     QString hlSection(int n);
     bool hlHidden(int n);
 
-    void incDynamicCtxs() { ++dynamicCtxsCount; }
-    int countDynamicCtxs() { return dynamicCtxsCount; }
     void setForceNoDCReset(bool b) { forceNoDCReset = b; }
 
-    // be carefull: all documents hl should be invalidated after having successfully called this method!
-    bool resetDynamicCtxs();
+    // be carefull: all documents using hl should be invalidated after having successfully called this method!
+    bool resetDynamicCtxs(KateHighlighting *hl);
 
   Q_SIGNALS:
     void changed();
@@ -105,8 +103,6 @@ class KateHlManager : public QObject
 
     KateSyntaxDocument *syntax;
 
-    int dynamicCtxsCount;
-    QTime lastCtxsReset;
     bool forceNoDCReset;
 };
 
@@ -3139,6 +3139,9 @@ void KateView::slotDelayedUpdateOfView ()
   if (m_lineToUpdateMin != -1 && m_lineToUpdateMax != -1) {
     tagLines (m_lineToUpdateMin, m_lineToUpdateMax, true);
     updateView (true);
+
+    // the minimap shows the range attributes, too
+    m_viewInternal->m_lineScroll->queuePixmapUpdate (m_lineToUpdateMin, m_lineToUpdateMax);
   }
 
   // reset flags
@@ -116,6 +116,13 @@ KateScrollBar::KateScrollBar (Qt::Orientation orientation, KateViewInternal* par
   , m_miniMapAll(true)
   , m_miniMapWidth(40)
   , m_grooveHeight(height())
+  , m_fullPixmapUpdate(true)
+  , m_dirtyStartLine(-1)
+  , m_dirtyEndLine(-1)
+  , m_pixmapDocLineCount(-1)
+  , m_pixmapLineIncrement(-1)
+  , m_pixmapCharIncrement(-1)
+  , m_pixmapLineDivisor(-1)
   , m_linesModified(0)
 {
   connect(this, SIGNAL(valueChanged(int)), this, SLOT(sliderMaybeMoved(int)));
@@ -131,14 +138,26 @@ KateScrollBar::KateScrollBar (Qt::Orientation orientation, KateViewInternal* par
 void KateScrollBar::setShowMiniMap(bool b)
 {
   if (b && !m_showMiniMap) {
-    connect(m_view, SIGNAL(selectionChanged(KTextEditor::View*)), &m_updateTimer, SLOT(start()), Qt::UniqueConnection);
-    connect(m_doc, SIGNAL(textChanged(KTextEditor::Document*)), &m_updateTimer, SLOT(start()), Qt::UniqueConnection);
-    connect(m_view, SIGNAL(delayedUpdateOfView()), &m_updateTimer, SLOT(start()), Qt::UniqueConnection);
+    connect(m_view, SIGNAL(selectionChanged(KTextEditor::View*)), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
+    connect(&m_doc->buffer(), SIGNAL(textInserted(KTextEditor::Cursor,QString)), this, SLOT(textInserted(KTextEditor::Cursor)), Qt::UniqueConnection);
+    connect(&m_doc->buffer(), SIGNAL(textRemoved(KTextEditor::Range,QString)), this, SLOT(textRemoved(KTextEditor::Range)), Qt::UniqueConnection);
+    connect(&m_doc->buffer(), SIGNAL(lineWrapped(KTextEditor::Cursor)), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
+    connect(&m_doc->buffer(), SIGNAL(lineUnwrapped(int)), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
+    connect(&m_doc->buffer(), SIGNAL(tagLines(int,int)), this, SLOT(queuePixmapUpdate(int,int)), Qt::UniqueConnection);
+    // loading or reloading a file fills the buffer without any edit signals
+    connect(&m_doc->buffer(), SIGNAL(cleared()), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
+    connect(&m_doc->buffer(), SIGNAL(loaded(QString,bool)), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
     connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(updatePixmap()), Qt::UniqueConnection);
-    connect(&(m_view->textFolding()), SIGNAL(foldingRangesChanged()), &m_updateTimer, SLOT(start()), Qt::UniqueConnection);
+    connect(&(m_view->textFolding()), SIGNAL(foldingRangesChanged()), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
+    connect(m_doc, SIGNAL(documentSavedOrUploaded(KTextEditor::Document*,bool)), this, SLOT(queuePixmapUpdate()), Qt::UniqueConnection);
+    m_fullPixmapUpdate = true;
   }
   else if (!b) {
     disconnect(&m_updateTimer);
+    disconnect(m_view, SIGNAL(selectionChanged(KTextEditor::View*)), this, SLOT(queuePixmapUpdate()));
+    disconnect(&m_doc->buffer(), 0, this, 0);
+    disconnect(&(m_view->textFolding()), SIGNAL(foldingRangesChanged()), this, SLOT(queuePixmapUpdate()));
+    disconnect(m_doc, SIGNAL(documentSavedOrUploaded(KTextEditor::Document*,bool)), this, SLOT(queuePixmapUpdate()));
   }
 
   m_showMiniMap = b;
@@ -374,8 +393,39 @@ void KateScrollBar::updatePixmap()
   modifiedLineColor.setHsv(modifiedLineColor.hue(), 255, 255 - backgroundColor.value()/3);
   savedLineColor.setHsv(savedLineColor.hue(), 100, 255 - backgroundColor.value()/3);
 
-  m_pixmap = QPixmap(pixmapLineWidth, pixmapLineCount);
-  m_pixmap.fill(QColor("transparent"));
+  // only some lines changed and the minimap is still laid out the same way:
+  // just redraw the pixel rows of these lines, typing should not cost a complete rebuild
+  const bool partialUpdate = !m_fullPixmapUpdate
+                          && m_pixmap.size() == QSize(pixmapLineWidth, pixmapLineCount)
+                          && m_pixmapDocLineCount == docLineCount
+                          && m_pixmapLineIncrement == lineIncrement
+                          && m_pixmapCharIncrement == charIncrement
+                          && m_pixmapLineDivisor == lineDivisor;
+
+  // rows to draw, the text rows and the modification marker rows of the dirty lines
+  int firstRow = 0;
+  int lastRow = pixmapLineCount - 1;
+  if (partialUpdate) {
+    if (m_dirtyStartLine == -1)
+      return;
+
+    const int firstLine = m_view->textFolding().lineToVisibleLine(m_dirtyStartLine);
+    const int lastLine = m_view->textFolding().lineToVisibleLine(qMin(m_dirtyEndLine, m_doc->lastLine()));
+    firstRow = qMin(firstLine / lineIncrement / charIncrement, firstLine / lineDivisor);
+    lastRow = qMax(lastLine / lineIncrement / charIncrement, lastLine / lineDivisor);
+  } else {
+    m_pixmap = QPixmap(pixmapLineWidth, pixmapLineCount);
+    m_pixmap.fill(QColor("transparent"));
+
+    m_pixmapDocLineCount = docLineCount;
+    m_pixmapLineIncrement = lineIncrement;
+    m_pixmapCharIncrement = charIncrement;
+    m_pixmapLineDivisor = lineDivisor;
+  }
+
+  m_fullPixmapUpdate = false;
+  m_dirtyStartLine = -1;
+  m_dirtyEndLine = -1;
 
   // The text currently selected in the document, to be drawn later.
   const Range& selection = m_view->selectionRange();
@@ -385,11 +435,19 @@ void KateScrollBar::updatePixmap()
     // Do not force updates of the highlighting if the document is very large
     bool simpleMode = m_doc->lines() > 7500;
 
-    int pixelY = 0;
-    int drawnLines = 0;
+    // clear the rows to redraw
+    if (partialUpdate) {
+      painter.setCompositionMode(QPainter::CompositionMode_Source);
+      painter.fillRect(0, firstRow, pixmapLineWidth, lastRow - firstRow + 1, Qt::transparent);
+      painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    }
+
+    int pixelY = firstRow;
+    int drawnLines = firstRow * charIncrement;
 
-    // Iterate over all visible lines, drawing them.
-    for (int virtualLine=0; virtualLine < docLineCount; virtualLine += lineIncrement) {
+    // Iterate over all visible lines of the rows, drawing them.
+    const int endLine = qMin(docLineCount, (lastRow + 1) * charIncrement * lineIncrement);
+    for (int virtualLine = drawnLines * lineIncrement; virtualLine < endLine; virtualLine += lineIncrement) {
 
       int realLineNumber = m_view->textFolding().visibleLineToLine(virtualLine);
       QString lineText = m_doc->line(realLineNumber);
@@ -456,8 +514,10 @@ void KateScrollBar::updatePixmap()
     // Draw line modification marker map.
     // Disable this if the document is really huge,
     // since it requires querying every line.
+    // A marker also covers the row below its own one.
     if ( m_doc->lines() < 50000 ) {
-      for ( int lineno = 0; lineno < docLineCount; lineno++ ) {
+      const int endMarkerLine = qMin(docLineCount, (lastRow + 1) * lineDivisor);
+      for ( int lineno = qMax(0, (firstRow - 1) * lineDivisor); lineno < endMarkerLine; lineno++ ) {
         int realLineNo = m_view->textFolding().visibleLineToLine(lineno);
         const Kate::TextLine& line = m_doc->plainKateTextLine(realLineNo);
         if ( line->markedAsModified() ) {
@@ -478,6 +538,27 @@ void KateScrollBar::updatePixmap()
   update();
 }
 
+void KateScrollBar::queuePixmapUpdate(int startLine, int endLine)
+{
+  if (m_dirtyStartLine == -1 || startLine < m_dirtyStartLine)
+    m_dirtyStartLine = startLine;
+
+  if (endLine > m_dirtyEndLine)
+    m_dirtyEndLine = endLine;
+
+  m_updateTimer.start();
+}
+
+void KateScrollBar::textInserted(const KTextEditor::Cursor &position)
+{
+  queuePixmapUpdate(position.line(), position.line());
+}
+
+void KateScrollBar::textRemoved(const KTextEditor::Range &range)
+{
+  queuePixmapUpdate(range.start().line(), range.end().line());
+}
+
 void KateScrollBar::miniMapPaintEvent(QPaintEvent *e)
 {
   QScrollBar::paintEvent(e);
@@ -696,7 +777,7 @@ void KateScrollBar::normalPaintEvent(QPaintEvent *e)
 void KateScrollBar::resizeEvent(QResizeEvent *e)
 {
   QScrollBar::resizeEvent(e);
-  m_updateTimer.start();
+  queuePixmapUpdate();
   m_lines.clear();
   update();
 }
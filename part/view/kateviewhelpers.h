@@ -51,6 +51,7 @@ namespace KTextEditor {
   class Command;
   class AnnotationModel;
   class MovingRange;
+  class Range;
 }
 
 class QTimer;
@@ -83,8 +84,6 @@ class KateScrollBar : public QScrollBar
     inline bool miniMapWidth() { return m_miniMapWidth; }
     inline void setMiniMapWidth(int width) { m_miniMapWidth = width; updateGeometry(); update(); }
 
-    inline void queuePixmapUpdate() { m_updateTimer.start(); }
-
 Q_SIGNALS:
     void sliderMMBMoved(int value);
 
@@ -104,6 +103,20 @@ Q_SIGNALS:
   public Q_SLOTS:
     void updatePixmap();
 
+    /**
+     * Rebuild the whole minimap soon.
+     */
+    inline void queuePixmapUpdate() { m_fullPixmapUpdate = true; m_updateTimer.start(); }
+
+    /**
+     * Redraw the minimap rows of the given real lines soon.
+     */
+    void queuePixmapUpdate(int startLine, int endLine);
+
+  private Q_SLOTS:
+    void textInserted(const KTextEditor::Cursor &position);
+    void textRemoved(const KTextEditor::Range &range);
+
   private:
     void redrawMarks();
     void recomputeMarksPositions();
@@ -140,6 +153,17 @@ Q_SIGNALS:
     QTimer  m_updateTimer;
     QPoint m_toolTipPos;
 
+    // the minimap has to be rebuilt completely, else only the dirty lines are redrawn
+    bool m_fullPixmapUpdate;
+    int m_dirtyStartLine;
+    int m_dirtyEndLine;
+
+    // layout of the current minimap pixmap, a partial update needs the same
+    int m_pixmapDocLineCount;
+    int m_pixmapLineIncrement;
+    int m_pixmapCharIncrement;
+    int m_pixmapLineDivisor;
+
     // lists of lines added/removed recently to avoid scrollbar flickering
     QHash<int, int> m_linesAdded;
     int m_linesModified;
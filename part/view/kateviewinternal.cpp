@@ -1357,36 +1357,31 @@ KTextEditor::Cursor KateViewInternal::viewLineOffset(const KTextEditor::Cursor&
     if (!thisLine)
       break;
 
-    for (int i = 0; i < thisLine->viewLineCount(); ++i) {
-      if (offset == currentOffset) {
-        KateTextLayout thisViewLine = thisLine->viewLine(i);
-
-        if (!forwards) {
-          // We actually want it the other way around
-          int requiredViewLine = cache()->lastViewLine(realLine) - thisViewLine.viewLine();
-          if (requiredViewLine != thisViewLine.viewLine()) {
-            thisViewLine = thisLine->viewLine(requiredViewLine);
-          }
-        }
+    // skip whole lines, only the line containing the target needs a look at its view lines
+    const int viewLineCount = thisLine->viewLineCount();
+    if (offset < currentOffset + viewLineCount) {
+      const int i = offset - currentOffset;
 
-        KTextEditor::Cursor ret(virtualLine, thisViewLine.startCol());
+      // backwards we count from the last view line of the line
+      KateTextLayout thisViewLine = thisLine->viewLine(forwards ? i : (viewLineCount - 1 - i));
 
-        // keep column position
-        if (keepX) {
-          KTextEditor::Cursor realCursor = toRealCursor(virtualCursor);
-          KateTextLayout t = cache()->textLayout(realCursor);
-          // renderer()->cursorToX(t, realCursor, !m_view->wrapCursor());
+      KTextEditor::Cursor ret(virtualLine, thisViewLine.startCol());
 
-          realCursor = renderer()->xToCursor(thisViewLine, m_preservedX, !m_view->wrapCursor());
-          ret.setColumn(realCursor.column());
-        }
+      // keep column position
+      if (keepX) {
+        KTextEditor::Cursor realCursor = toRealCursor(virtualCursor);
+        KateTextLayout t = cache()->textLayout(realCursor);
+        // renderer()->cursorToX(t, realCursor, !m_view->wrapCursor());
 
-        return ret;
+        realCursor = renderer()->xToCursor(thisViewLine, m_preservedX, !m_view->wrapCursor());
+        ret.setColumn(realCursor.column());
       }
 
-      currentOffset++;
+      return ret;
     }
 
+    currentOffset += viewLineCount;
+
     if (forwards)
       virtualLine++;
     else
@@ -2119,6 +2114,44 @@ void KateViewInternal::paintCursor()
     updateDirty(); //paintText (0,0,width(), height(), true);
 }
 
+void KateViewInternal::paintCaret()
+{
+  // block caret behind the end of the line, drawn by the renderer itself, take the whole line
+  const KTextEditor::Cursor realCursor = toRealCursor(m_displayCursor);
+  if (realCursor.column() > doc()->lineLength(realCursor.line())) {
+    paintCursor();
+    return;
+  }
+
+  // not visible, nothing to do
+  const int viewLine = cache()->displayViewLine(m_displayCursor, true);
+  if (viewLine < 0 || viewLine >= cache()->viewCacheLineCount())
+    return;
+
+  const KateTextLayout layout = cache()->viewLine(viewLine);
+  if (!layout.isValid()) {
+    paintCursor();
+    return;
+  }
+
+  // caret width as determined by KateRenderer::paintTextLine: a line caret is thin,
+  // the other styles cover the character under the cursor
+  const QTextLine line = layout.lineLayout();
+  const int column = realCursor.column();
+  int caretWidth = 2;
+  if (renderer()->caretStyle() != KateRenderer::Line) {
+    if (column < doc()->lineLength(realCursor.line()))
+      caretWidth = qAbs(int(line.cursorToX(column + 1) - line.cursorToX(column)));
+    caretWidth = qMax(caretWidth, int(renderer()->spaceWidth()) + 1);
+  }
+
+  // no need to tag the line or touch the border, just repaint around the caret,
+  // in both directions for right-to-left text
+  const int x = int(line.cursorToX(column)) - startX();
+  const int y = viewLine * renderer()->lineHeight();
+  update(x - caretWidth - 2, y, 2 * caretWidth + 4, renderer()->lineHeight());
+}
+
 // Point in content coordinates
 void KateViewInternal::placeCursor( const QPoint& p, bool keepSelection, bool updateSelection )
 {
@@ -3097,7 +3130,7 @@ void KateViewInternal::cursorTimeout ()
 {
   if (!debugPainting && !m_view->viInputMode()) {
     renderer()->setDrawCaret(!renderer()->drawCaret());
-    paintCursor();
+    paintCaret();
   }
 }
 
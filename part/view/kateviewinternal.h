@@ -253,6 +253,11 @@ class KateViewInternal : public QWidget
 
     void paintCursor();
 
+    /**
+     * Repaint only the area of the caret, enough when it just blinks.
+     */
+    void paintCaret();
+
     void placeCursor( const QPoint& p, bool keepSelection = false, bool updateSelection = true );
     bool isTargetSelected( const QPoint& p );
     //Returns whether the given range affects the area currently visible in the view
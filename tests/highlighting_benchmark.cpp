@@ -0,0 +1,188 @@
+/* This file is part of the KDE libraries
+
+   This library is free software; you can redistribute it and/or
+   modify it under the terms of the GNU Library General Public
+   License as published by the Free Software Foundation; either
+   version 2 of the License, or (at your option) any later version.
+
+   This library is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Library General Public License for more details.
+
+   You should have received a copy of the GNU Library General Public License
+   along with this library; see the file COPYING.LIB.  If not, write to
+   the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+   Boston, MA 02110-1301, USA.
+*/
+
+#include "highlighting_benchmark.h"
+#include "moc_highlighting_benchmark.cpp"
+
+#include <qtest_kde.h>
+
+#include <katedocument.h>
+#include <katebuffer.h>
+#include <katehighlight.h>
+#include <katetextline.h>
+#include <ktexteditor/cursor.h>
+#include <ktexteditor/range.h>
+
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QTime>
+
+using namespace KTextEditor;
+
+QTEST_KDEMAIN(HighlightingBenchmark, GUI)
+
+/**
+ * Minimal number of lines of each benchmark document
+ */
+static const int BENCHMARK_LINES = 20000;
+
+/**
+ * Text of the given file in the source tree, repeated up to BENCHMARK_LINES lines
+ */
+static QString repeatedFile(const QString &fileName)
+{
+  QFile file(KDESRCDIR + fileName);
+  if (!file.open(QIODevice::ReadOnly))
+    return QString();
+
+  QString text = QString::fromUtf8(file.readAll());
+  if (!text.endsWith('\n'))
+    text += '\n';
+
+  const int copies = BENCHMARK_LINES / qMax(1, text.count('\n')) + 1;
+  QString result;
+  result.reserve(copies * text.size());
+  for (int i = 0; i < copies; ++i)
+    result += text;
+
+  return result;
+}
+
+/**
+ * Given pattern with the line number as %1, repeated up to BENCHMARK_LINES lines
+ */
+static QString repeatedPattern(const QString &pattern)
+{
+  const int linesPerCopy = qMax(1, pattern.count('\n'));
+  QString result;
+  for (int i = 0; i * linesPerCopy < BENCHMARK_LINES; ++i)
+    result += pattern.arg(i);
+
+  return result;
+}
+
+HighlightingBenchmark::HighlightingBenchmark()
+  : QObject()
+{
+}
+
+HighlightingBenchmark::~HighlightingBenchmark()
+{
+}
+
+void HighlightingBenchmark::benchmarkFullHighlighting_data()
+{
+  QTest::addColumn<QString>("text");
+  QTest::addColumn<QString>("mode");
+
+  QTest::newRow("C++") << repeatedFile("../part/document/katedocument.cpp") << "C++";
+  QTest::newRow("Python") << repeatedFile("../doc/pate/conf.py") << "Python";
+  QTest::newRow("XML") << repeatedFile("../part/syntax/data/cpp.xml") << "XML";
+  QTest::newRow("JavaScript") << repeatedFile("../part/script/data/commands/utils.js") << "JavaScript";
+  QTest::newRow("Perl") << repeatedFile("../part/syntax/data/generate-php.pl") << "Perl";
+  QTest::newRow("Bash") << repeatedFile("../part/syntax/data/cmake-gen.sh") << "Bash";
+
+  QTest::newRow("SQL") << repeatedPattern(
+      "SELECT u.id, u.name, count(o.id) FROM users u INNER JOIN orders o ON o.user_id = u.id\n"
+      "WHERE u.name LIKE 'a%' AND o.total > %1 GROUP BY u.id, u.name ORDER BY 3 DESC; -- query %1\n") << "SQL";
+
+  QTest::newRow("Markdown") << repeatedPattern(
+      "# Heading %1\n"
+      "\n"
+      "Some *emphasized* and **strong** text with `code` and a [link](http://kde.org).\n"
+      "\n"
+      "* first item\n"
+      "* second item\n"
+      "\n"
+      "    indented code %1\n"
+      "\n") << "Markdown";
+
+  // every here document has its own terminator, each one creates a new dynamic context
+  QTest::newRow("Perl here documents") << repeatedPattern(
+      "print <<EOT%1;\n"
+      "some text with $variable and @array in here document %1\n"
+      "EOT%1\n") << "Perl";
+}
+
+void HighlightingBenchmark::benchmarkFullHighlighting()
+{
+  QFETCH(QString, text);
+  QFETCH(QString, mode);
+
+  KateDocument doc(false, false, false);
+  doc.setText(text);
+  QVERIFY(doc.setHighlightingMode(mode));
+  QVERIFY(doc.lines() >= BENCHMARK_LINES);
+
+  // highlight the whole document again for each iteration
+  QBENCHMARK {
+    doc.buffer().invalidateHighlighting();
+    doc.buffer().ensureHighlighted(doc.lines() - 1, 0);
+  }
+
+  QCOMPARE(doc.buffer().lineHighlighted(), doc.lines());
+
+  // report the throughput of one more pass
+  QTime t;
+  t.start();
+  doc.buffer().invalidateHighlighting();
+  doc.buffer().ensureHighlighted(doc.lines() - 1, 0);
+  const int elapsed = qMax(1, t.elapsed());
+
+  qDebug() << mode << ":" << (qint64(doc.lines()) * 1000 / elapsed) << "lines/s,"
+           << doc.highlight()->dynamicContextsCount() << "dynamic contexts";
+}
+
+void HighlightingBenchmark::benchmarkEditHighlighting_data()
+{
+  QTest::addColumn<double>("position");
+  QTest::addColumn<QString>("insertion");
+
+  QTest::newRow("type at top") << 0.0 << "x";
+  QTest::newRow("type in middle") << 0.5 << "x";
+  QTest::newRow("type at end") << 1.0 << "x";
+  QTest::newRow("comment out at top") << 0.0 << "/*";
+  QTest::newRow("new line in middle") << 0.5 << "\n";
+}
+
+void HighlightingBenchmark::benchmarkEditHighlighting()
+{
+  QFETCH(double, position);
+  QFETCH(QString, insertion);
+
+  KateDocument doc(false, false, false);
+  doc.setText(repeatedFile("../part/document/katedocument.cpp"));
+  QVERIFY(doc.setHighlightingMode("C++"));
+  doc.buffer().ensureHighlighted(doc.lines() - 1, 0);
+
+  const int line = qMin(int(doc.lines() * position), doc.lines() - 1);
+  const Range inserted = (insertion == "\n") ? Range(line, 0, line + 1, 0)
+                                             : Range(line, 0, line, insertion.length());
+
+  // each edit rehighlights from the changed line until the highlighting converges again
+  const quint64 allocations = Kate::TextLineData::heapAllocations();
+  QBENCHMARK {
+    doc.insertText(inserted.start(), insertion);
+    doc.removeText(inserted);
+  }
+
+  qDebug() << (Kate::TextLineData::heapAllocations() - allocations) << "line allocations";
+  QVERIFY(doc.buffer().lineHighlighted() > line);
+}
+
+#include "highlighting_benchmark.moc"
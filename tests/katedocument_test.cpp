@@ -24,7 +24,9 @@
 
 #include <katedocument.h>
 #include <ktexteditor/movingcursor.h>
+#include <ktexteditor/view.h>
 #include <kateconfig.h>
+#include <katehighlight.h>
 #include <ktemporaryfile.h>
 
 ///TODO: is there a FindValgrind cmake command we could use to
@@ -345,4 +347,75 @@ void KateDocumentTest::testDigest()
   QCOMPARE(docDigest, fileDigest);
 }
 
+void KateDocumentTest::testCaseInsensitiveKeywords()
+{
+  KateDocument doc(false, false, false);
+  doc.setText("SELECT select SeLeCt selectx");
+  QVERIFY(doc.setHighlightingMode("SQL"));
+  doc.buffer().ensureHighlighted(0);
+
+  // all spellings are the same keyword, the last word is no keyword at all
+  const Kate::TextLine line = doc.kateTextLine(0);
+  QVERIFY(line->attribute(0) > 0);
+  QCOMPARE(line->attribute(7), line->attribute(0));
+  QCOMPARE(line->attribute(14), line->attribute(0));
+  QVERIFY(line->attribute(21) != line->attribute(0));
+}
+
+void KateDocumentTest::testBackgroundHighlighting()
+{
+  KateDocument doc(false, false, false);
+  QVERIFY(doc.openUrl(QString(KDESRCDIR + QString("../part/document/katedocument.cpp"))));
+  QVERIFY(doc.setHighlightingMode("C++"));
+  KTextEditor::View *view = doc.createView(0);
+
+  // only the requested lines are highlighted at once
+  doc.buffer().ensureHighlighted(0);
+  QVERIFY(doc.buffer().lineHighlighted() > 0);
+  QVERIFY(doc.buffer().lineHighlighted() < doc.lines());
+
+  // the rest follows while the event loop runs
+  for (int i = 0; i < 500 && doc.buffer().lineHighlighted() < doc.lines(); ++i)
+    QTest::qWait(10);
+  QCOMPARE(doc.buffer().lineHighlighted(), doc.lines());
+
+  delete view;
+}
+
+void KateDocumentTest::testLongLineHighlighting()
+{
+  KateDocument doc(false, false, false);
+  doc.setText("s = \"" + QString(4 * KATE_HL_MAX_LINE_LENGTH, 'a') + "\";");
+  QVERIFY(doc.setHighlightingMode("C++"));
+  doc.buffer().ensureHighlighted(0);
+
+  // beyond the limit the line just continues the string of the highlighted part
+  const Kate::TextLine line = doc.kateTextLine(0);
+  QVERIFY(line->attribute(10) > 0);
+  QCOMPARE(line->attribute(KATE_HL_MAX_LINE_LENGTH + 1), line->attribute(10));
+  QCOMPARE(line->attribute(line->length() - 1), line->attribute(10));
+
+  // a line continuation at the highlighting limit doesn't continue a longer line
+  KateDocument plainDoc(false, false, false);
+  plainDoc.setText("int y;");
+  QVERIFY(plainDoc.setHighlightingMode("C++"));
+  plainDoc.buffer().ensureHighlighted(0);
+
+  KateDocument continueDoc(false, false, false);
+  continueDoc.setText("#define X " + QString(KATE_HL_MAX_LINE_LENGTH - 11, 'a') + "\\" + QString(100, 'b') + "\nint y;");
+  QCOMPARE(continueDoc.line(0).at(KATE_HL_MAX_LINE_LENGTH - 1), QChar('\\'));
+  QVERIFY(continueDoc.setHighlightingMode("C++"));
+  continueDoc.buffer().ensureHighlighted(1);
+  QVERIFY(!continueDoc.kateTextLine(0)->hlLineContinue());
+  QCOMPARE(continueDoc.kateTextLine(1)->attribute(0), plainDoc.kateTextLine(0)->attribute(0));
+
+  // neither does a comment opened before the limit and closed behind it
+  KateDocument commentDoc(false, false, false);
+  commentDoc.setText("/* " + QString(KATE_HL_MAX_LINE_LENGTH, 'a') + " */ int x;\nint y;");
+  QVERIFY(commentDoc.setHighlightingMode("C++"));
+  commentDoc.buffer().ensureHighlighted(1);
+  QCOMPARE(commentDoc.kateTextLine(1)->attribute(0), plainDoc.kateTextLine(0)->attribute(0));
+  QVERIFY(!commentDoc.kateTextLine(0)->markedAsFoldingStartAttribute());
+}
+
 #include "katedocument_test.moc"
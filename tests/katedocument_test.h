@@ -44,6 +44,12 @@ private Q_SLOTS:
   void testInsertNewline();
 
   void testDigest();
+
+  void testCaseInsensitiveKeywords();
+
+  void testBackgroundHighlighting();
+
+  void testLongLineHighlighting();
 };
 
 #endif // KATE_DOCUMENT_TEST_H
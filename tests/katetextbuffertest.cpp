@@ -22,9 +22,14 @@
 #include "katetextbuffertest.h"
 #include "katetextbuffer.h"
 #include "katetextcursor.h"
+#include "katetextrange.h"
 #include "katetextfolding.h"
+#include "katedocument.h"
+#include "katebuffer.h"
 
-QTEST_MAIN(KateTextBufferTest)
+#include <qtest_kde.h>
+
+QTEST_KDEMAIN(KateTextBufferTest, GUI)
 
 KateTextBufferTest::KateTextBufferTest()
   : QObject()
@@ -207,6 +212,162 @@ void KateTextBufferTest::cursorTest()
   }
 }
 
+void KateTextBufferTest::cursorsOnSameColumnTest()
+{
+  // construct a text buffer with one line
+  Kate::TextBuffer buffer (0, 1);
+  buffer.startEditing ();
+  buffer.insertText (KTextEditor::Cursor (0, 0), "0123456789");
+  buffer.finishEditing ();
+
+  // cursors on the same column, alternating insert behavior
+  QList<Kate::TextCursor *> cursors;
+  for (int i = 0; i < 10; ++i)
+    cursors.append (new Kate::TextCursor (buffer, KTextEditor::Cursor (0, 5), (i % 2) ? Kate::TextCursor::MoveOnInsert : Kate::TextCursor::StayOnInsert));
+
+  // insert at their column, only every second one moves
+  buffer.startEditing ();
+  buffer.insertText (KTextEditor::Cursor (0, 5), "abc");
+  buffer.finishEditing ();
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE (cursors[i]->toCursor (), KTextEditor::Cursor (0, (i % 2) ? 8 : 5));
+
+  // insert again in front, all move
+  buffer.startEditing ();
+  buffer.insertText (KTextEditor::Cursor (0, 0), "x");
+  buffer.finishEditing ();
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE (cursors[i]->toCursor (), KTextEditor::Cursor (0, (i % 2) ? 9 : 6));
+
+  // wrap between them and unwrap again
+  buffer.startEditing ();
+  buffer.wrapLine (KTextEditor::Cursor (0, 7));
+  buffer.finishEditing ();
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE (cursors[i]->toCursor (), (i % 2) ? KTextEditor::Cursor (1, 2) : KTextEditor::Cursor (0, 6));
+
+  buffer.startEditing ();
+  buffer.unwrapLine (1);
+  buffer.finishEditing ();
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE (cursors[i]->toCursor (), KTextEditor::Cursor (0, (i % 2) ? 9 : 6));
+
+  // remove text covering the moving ones, they collapse to the start
+  buffer.startEditing ();
+  buffer.removeText (KTextEditor::Range (KTextEditor::Cursor (0, 7), KTextEditor::Cursor (0, 10)));
+  buffer.finishEditing ();
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE (cursors[i]->toCursor (), KTextEditor::Cursor (0, (i % 2) ? 7 : 6));
+
+  // move cursors around, each one must still be found in its block
+  for (int i = 0; i < 10; ++i)
+    cursors[i]->setPosition (KTextEditor::Cursor (0, 10 - i));
+  buffer.startEditing ();
+  buffer.insertText (KTextEditor::Cursor (0, 6), "yy");
+  buffer.finishEditing ();
+  for (int i = 0; i < 10; ++i)
+    QCOMPARE (cursors[i]->toCursor (), KTextEditor::Cursor (0, (10 - i >= 6 && !(10 - i == 6 && (i % 2) == 0)) ? 12 - i : 10 - i));
+
+  qDeleteAll (cursors);
+}
+
+void KateTextBufferTest::typingWithManyRangesBenchmark()
+{
+  // construct a text buffer with 1000 lines of 200 characters
+  Kate::TextBuffer buffer (0);
+  buffer.startEditing ();
+  buffer.insertText (KTextEditor::Cursor (0, 0), QString (200, QLatin1Char ('x')));
+  for (int line = 0; line < 999; ++line)
+    buffer.wrapLine (KTextEditor::Cursor (line, 200));
+  for (int line = 1; line < 1000; ++line)
+    buffer.insertText (KTextEditor::Cursor (line, 0), QString (200, QLatin1Char ('x')));
+  buffer.finishEditing ();
+
+  // 100k moving ranges, e.g. from spell checking or search highlighting
+  QList<Kate::TextRange *> ranges;
+  for (int line = 0; line < 1000; ++line)
+    for (int column = 0; column < 200; column += 2)
+      ranges.append (new Kate::TextRange (buffer, KTextEditor::Range (line, column, line, column + 1), KTextEditor::MovingRange::ExpandLeft | KTextEditor::MovingRange::ExpandRight));
+
+  // type and delete in the middle of the document
+  QBENCHMARK {
+    buffer.startEditing ();
+    buffer.insertText (KTextEditor::Cursor (500, 100), "a");
+    buffer.removeText (KTextEditor::Range (KTextEditor::Cursor (500, 100), KTextEditor::Cursor (500, 101)));
+    buffer.finishEditing ();
+  }
+
+  QCOMPARE (ranges.last()->toRange (), KTextEditor::Range (999, 198, 999, 199));
+  qDeleteAll (ranges);
+}
+
+void KateTextBufferTest::lineIndexTest()
+{
+  // test with different block sizes, small ones trigger a lot of splits and merges
+  for (int i = 1; i <= 4; ++i) {
+    // construct an empty text buffer
+    Kate::TextBuffer buffer (0, i);
+
+    // create 100 lines, always wrap in front of the last line
+    buffer.startEditing ();
+    for (int line = 0; line < 100; ++line) {
+      buffer.insertText (KTextEditor::Cursor (line, 0), QString::number (line));
+      buffer.wrapLine (KTextEditor::Cursor (line, QString::number (line).size()));
+    }
+    buffer.finishEditing ();
+    QCOMPARE (buffer.lines (), 101);
+
+    // cursor at the end, will move with all edits in front of it
+    Kate::TextCursor *cursor = new Kate::TextCursor (buffer, KTextEditor::Cursor (100, 0), Kate::TextCursor::MoveOnInsert);
+
+    // wrap lines in front of the others, each line must still be found
+    buffer.startEditing ();
+    for (int line = 0; line < 50; ++line)
+      buffer.wrapLine (KTextEditor::Cursor (line * 2, 0));
+    buffer.finishEditing ();
+    QCOMPARE (buffer.lines (), 151);
+    QCOMPARE (cursor->toCursor (), KTextEditor::Cursor (150, 0));
+    for (int line = 0; line < 50; ++line) {
+      QCOMPARE (buffer.line (line * 2)->text (), QString ());
+      QCOMPARE (buffer.line (line * 2 + 1)->text (), QString::number (line));
+    }
+    for (int line = 50; line < 100; ++line)
+      QCOMPARE (buffer.line (line + 50)->text (), QString::number (line));
+
+    // unwrap them again, this will merge blocks
+    buffer.startEditing ();
+    for (int line = 0; line < 50; ++line)
+      buffer.unwrapLine (line + 1);
+    buffer.finishEditing ();
+    QCOMPARE (buffer.lines (), 101);
+    QCOMPARE (cursor->toCursor (), KTextEditor::Cursor (100, 0));
+    for (int line = 0; line < 100; ++line)
+      QCOMPARE (buffer.line (line)->text (), QString::number (line));
+
+    delete cursor;
+  }
+}
+
+void KateTextBufferTest::wrapLineAtStartBenchmark()
+{
+  // construct a text buffer with the default block size and many lines
+  Kate::TextBuffer buffer (0);
+  buffer.startEditing ();
+  for (int line = 0; line < 200000; ++line)
+    buffer.wrapLine (KTextEditor::Cursor (0, 0));
+  buffer.finishEditing ();
+
+  // edit at the start of the buffer, all following blocks need new start lines
+  QBENCHMARK {
+    buffer.startEditing ();
+    buffer.wrapLine (KTextEditor::Cursor (0, 0));
+    buffer.unwrapLine (1);
+    buffer.finishEditing ();
+  }
+
+  QCOMPARE (buffer.lines (), 200001);
+}
+
 void KateTextBufferTest::foldingTest()
 {
     // construct an empty text buffer & folding info
@@ -447,3 +608,186 @@ void KateTextBufferTest::saveFileInUnwritableFolder()
   Q_ASSERT(f.remove());
   Q_ASSERT(QDir::temp().rmdir(folder_name));
 }
+
+void KateTextBufferTest::loadBenchmark()
+{
+  // create a large file, mixed line lengths and end of lines
+  const QString file_path = QDir::tempPath() + QString("/katetest_load_%1").arg(QCoreApplication::applicationPid());
+  QFile f(file_path);
+  QVERIFY(f.open(QIODevice::WriteOnly | QIODevice::Truncate));
+  for (int line = 0; line < 200000; ++line) {
+    f.write("2013-03-01 12:00:00;some;comma;separated;values;");
+    f.write(QByteArray::number(line));
+    f.write((line % 3) ? "\n" : "\r\n");
+  }
+  f.close();
+
+  Kate::TextBuffer buffer(0);
+  buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+  buffer.setFallbackTextCodec(QTextCodec::codecForName("UTF-8"));
+
+  QBENCHMARK {
+    bool encodingErrors, tooLongLinesWrapped;
+    QVERIFY(buffer.load(file_path, encodingErrors, tooLongLinesWrapped, true));
+    QVERIFY(!encodingErrors);
+  }
+
+  QCOMPARE(buffer.lines(), 200001);
+  QCOMPARE(buffer.line(199999)->text(), QString("2013-03-01 12:00:00;some;comma;separated;values;199999"));
+  QCOMPARE(buffer.endOfLineMode(), Kate::TextBuffer::eolDos);
+
+  QVERIFY(f.remove());
+}
+
+static int compactLineCount(KateDocument &doc)
+{
+  int count = 0;
+  for (int line = 0; line < doc.lines(); ++line)
+    if (doc.buffer().plainLine(line)->isCompact())
+      ++count;
+  return count;
+}
+
+void KateTextBufferTest::compactLineStorageTest()
+{
+  // some typical source files of our own tree
+  QStringList files;
+  files << "../part/buffer/katetextbuffer.cpp" << "../part/buffer/katetextblock.h" << "../part/syntax/katehighlight.cpp";
+
+  int textBytes[2] = { 0, 0 };
+  int lines = 0;
+  foreach (const QString &file, files) {
+    Kate::TextBuffer buffer (0);
+    buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+    buffer.setFallbackTextCodec(QTextCodec::codecForName("UTF-8"));
+
+    Kate::TextBuffer compactBuffer (0);
+    compactBuffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+    compactBuffer.setFallbackTextCodec(QTextCodec::codecForName("UTF-8"));
+    compactBuffer.setCompactLineStorage (true);
+
+    bool encodingErrors, tooLongLinesWrapped;
+    QVERIFY(buffer.load(KDESRCDIR + file, encodingErrors, tooLongLinesWrapped, true));
+    QVERIFY(compactBuffer.load(KDESRCDIR + file, encodingErrors, tooLongLinesWrapped, true));
+    QCOMPARE(compactBuffer.lines(), buffer.lines());
+
+    // sum up text memory, before inflating anything
+    for (int line = 0; line < buffer.lines(); ++line) {
+      textBytes[0] += buffer.line(line)->textMemoryUsage();
+      textBytes[1] += compactBuffer.line(line)->textMemoryUsage();
+    }
+    lines += buffer.lines();
+
+    // content must be the same, per line and in total
+    QCOMPARE(compactBuffer.text(), buffer.text());
+    for (int line = 0; line < buffer.lines(); ++line) {
+      QCOMPARE(compactBuffer.line(line)->length(), buffer.line(line)->length());
+      QCOMPARE(compactBuffer.line(line)->at(0), buffer.line(line)->at(0));
+      QCOMPARE(compactBuffer.line(line)->text(), buffer.line(line)->text());
+      QVERIFY(!compactBuffer.line(line)->isCompact());
+    }
+  }
+
+  qDebug() << "text bytes per line:" << double(textBytes[0]) / lines << "(QString)" << double(textBytes[1]) / lines << "(compact)";
+  QVERIFY(textBytes[1] < textBytes[0]);
+
+  // editing a compact line inflates it first
+  Kate::TextBuffer buffer (0);
+  buffer.setCompactLineStorage (true);
+  buffer.setTextCodec(QTextCodec::codecForName("UTF-8"));
+  buffer.setFallbackTextCodec(QTextCodec::codecForName("UTF-8"));
+  bool encodingErrors, tooLongLinesWrapped;
+  QVERIFY(buffer.load(KDESRCDIR + files.first(), encodingErrors, tooLongLinesWrapped, true));
+  QVERIFY(buffer.line(0)->isCompact());
+  const QString firstLine = buffer.line(0)->textCopy();
+
+  // read-only helpers work on the compact text
+  QVERIFY(buffer.line(0)->matchesAt(0, firstLine.left(2)));
+  QCOMPARE(buffer.line(0)->virtualLength(8), buffer.line(0)->toVirtualColumn(firstLine.length(), 8));
+  QCOMPARE(buffer.line(0)->fromVirtualColumn(buffer.line(0)->virtualLength(8), 8), firstLine.length());
+  QVERIFY(buffer.line(0)->isCompact());
+  buffer.startEditing();
+  buffer.insertText(KTextEditor::Cursor(0, 0), QString(QChar(0x20ac)));
+  buffer.finishEditing();
+  QVERIFY(!buffer.line(0)->isCompact());
+  QCOMPARE(buffer.line(0)->text(), QString(QChar(0x20ac)) + firstLine);
+
+  // highlighting the whole document must keep the lines compact
+  KateDocument doc (false, false, false);
+  QVERIFY(doc.openUrl(QString(KDESRCDIR + files.last())));
+  QVERIFY(doc.setHighlightingMode("C++"));
+  const int compactLines = compactLineCount(doc);
+  QVERIFY(compactLines > 0);
+
+  doc.buffer().ensureHighlighted(doc.lines() - 1);
+  QCOMPARE(doc.buffer().lineHighlighted(), doc.lines());
+  QCOMPARE(compactLineCount(doc), compactLines);
+
+  // so must searching the whole document, plain and with regular expressions
+  QVERIFY(doc.searchText(doc.documentRange(), "doHighlight", KTextEditor::Search::Default).first().isValid());
+  QVERIFY(doc.searchText(doc.documentRange(), "do[A-Z]\\w*", KTextEditor::Search::Regex).first().isValid());
+  QCOMPARE(compactLineCount(doc), compactLines);
+}
+
+void KateTextBufferTest::textLineAllocationTest()
+{
+  // construct a text buffer with some lines
+  Kate::TextBuffer buffer (0);
+  buffer.startEditing ();
+  buffer.insertText (KTextEditor::Cursor (0, 0), "some text");
+  for (int line = 0; line < 100; ++line)
+    buffer.wrapLine (KTextEditor::Cursor (0, 4));
+  buffer.finishEditing ();
+
+  // warm up, afterwards the memory of each removed line can be reused
+  buffer.startEditing ();
+  buffer.wrapLine (KTextEditor::Cursor (50, 2));
+  buffer.unwrapLine (51);
+  buffer.finishEditing ();
+
+  // typing enter + backspace many times must not need new memory for lines
+  const quint64 heapAllocations = Kate::TextLineData::heapAllocations ();
+  const quint64 recycledAllocations = Kate::TextLineData::recycledAllocations ();
+  for (int i = 0; i < 1000; ++i) {
+    buffer.startEditing ();
+    buffer.wrapLine (KTextEditor::Cursor (50, 2));
+    buffer.unwrapLine (51);
+    buffer.finishEditing ();
+  }
+
+  QCOMPARE (Kate::TextLineData::heapAllocations (), heapAllocations);
+  QVERIFY (Kate::TextLineData::recycledAllocations () >= recycledAllocations + 1000);
+  QCOMPARE (buffer.lines (), 101);
+}
+
+void KateTextBufferTest::attributeLookupTest()
+{
+  // attributes like the highlighting adds them, with gaps, merged neighbours and empty folding markers
+  Kate::TextLineData line ("int main() { return 0; } // comment");
+  line.addAttribute (Kate::TextLineData::Attribute (0, 3, 1));
+  line.addAttribute (Kate::TextLineData::Attribute (4, 4, 2));
+  line.addAttribute (Kate::TextLineData::Attribute (8, 1, 3, -1));
+  line.addAttribute (Kate::TextLineData::Attribute (11, 1, 3, 1));
+  line.addAttribute (Kate::TextLineData::Attribute (12, 0, 3, 1));
+  line.addAttribute (Kate::TextLineData::Attribute (13, 6, 4));
+  line.addAttribute (Kate::TextLineData::Attribute (19, 1, 4));
+  line.addAttribute (Kate::TextLineData::Attribute (25, 10, 5));
+
+  // compare with a linear scan over all attributes
+  for (int pos = -1; pos <= line.length () + 1; ++pos) {
+    short expected = 0;
+    foreach (const Kate::TextLineData::Attribute &attribute, line.attributesList ()) {
+      if (pos >= attribute.offset && pos < attribute.offset + attribute.length) {
+        expected = attribute.attributeValue;
+        break;
+      }
+    }
+
+    QCOMPARE (line.attribute (pos), expected);
+  }
+
+  QCOMPARE (line.attribute (3), short (0));
+  QCOMPARE (line.attribute (12), short (0));
+  QCOMPARE (line.attribute (19), short (4));
+  QCOMPARE (line.attribute (34), short (5));
+}
@@ -37,9 +37,17 @@ class KateTextBufferTest : public QObject
     void wrapLineTest();
     void insertRemoveTextTest();
     void cursorTest();
+    void cursorsOnSameColumnTest();
+    void typingWithManyRangesBenchmark();
+    void lineIndexTest();
+    void wrapLineAtStartBenchmark();
     void foldingTest();
     void nestedFoldingTest();
     void saveFileInUnwritableFolder();
+    void loadBenchmark();
+    void compactLineStorageTest();
+    void textLineAllocationTest();
+    void attributeLookupTest();
 };
 
 #endif // KATEBUFFERTEST_H
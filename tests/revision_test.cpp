@@ -178,3 +178,63 @@ void RevisionTest::testTransformRange()
     QCOMPARE(r2, Range(Cursor(1, 2), Cursor(1, 2)));
     QCOMPARE(invalidOnEmpty, Range::invalid());
 }
+
+// tests:
+// - transformCursor() over many single character edits, merged in the history
+void RevisionTest::testTransformAfterTyping()
+{
+    KateDocument doc (false, false, false);
+
+    doc.setText("abcd");
+
+    // lock current revision
+    const qint64 rev = doc.revision();
+    doc.lockRevision(rev);
+
+    // type in the middle of the line, char by char
+    for (int i = 0; i < 100; ++i)
+        doc.insertText(Cursor(0, 2 + i), "x");
+
+    // lock revision in between
+    const qint64 midRev = doc.revision();
+    doc.lockRevision(midRev);
+
+    // backspace some of it again
+    for (int i = 0; i < 10; ++i)
+        doc.removeText(Range(Cursor(0, 101 - i), Cursor(0, 102 - i)));
+
+    // and delete some in front
+    for (int i = 0; i < 5; ++i)
+        doc.removeText(Range(Cursor(0, 0), Cursor(0, 1)));
+
+    QCOMPARE(doc.line(0).size(), 4 + 100 - 10 - 5);
+
+    // transform from the first locked revision
+    Cursor beforeTyping(0, 1);
+    Cursor stayOnInsert(0, 2);
+    Cursor moveOnInsert(0, 2);
+    Cursor behindTyping(0, 3);
+    doc.transformCursor(beforeTyping, MovingCursor::MoveOnInsert, rev, -1);
+    doc.transformCursor(stayOnInsert, MovingCursor::StayOnInsert, rev, -1);
+    doc.transformCursor(moveOnInsert, MovingCursor::MoveOnInsert, rev, -1);
+    doc.transformCursor(behindTyping, MovingCursor::MoveOnInsert, rev, -1);
+    QCOMPARE(beforeTyping, Cursor(0, 0));
+    QCOMPARE(stayOnInsert, Cursor(0, 0));
+    QCOMPARE(moveOnInsert, Cursor(0, 87));
+    QCOMPARE(behindTyping, Cursor(0, 88));
+
+    // transform from the revision in between
+    Cursor typed(0, 50);
+    Cursor end(0, 102);
+    doc.transformCursor(typed, MovingCursor::MoveOnInsert, midRev, -1);
+    doc.transformCursor(end, MovingCursor::MoveOnInsert, midRev, -1);
+    QCOMPARE(typed, Cursor(0, 45));
+    QCOMPARE(end, Cursor(0, 87));
+
+    // and back again
+    doc.transformCursor(end, MovingCursor::MoveOnInsert, -1, midRev);
+    QCOMPARE(end, Cursor(0, 102));
+
+    doc.unlockRevision(midRev);
+    doc.unlockRevision(rev);
+}
@@ -33,6 +33,7 @@ public:
 private Q_SLOTS:
   void testTransformCursor();
   void testTransformRange();
+  void testTransformAfterTyping();
 };
 
 #endif // KATE_REVISION_TEST_H